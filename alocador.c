@@ -0,0 +1,320 @@
+#include <stdio.h>
+#include <stdlib.h>
+
+/* Índice de extensões livres para alocação contígua de blocos.
+   Cada extensão livre (início, tamanho) é um nó de duas treaps ao mesmo tempo:
+   - árvore 0, ordenada pelo início e aumentada com o maior tamanho da subárvore,
+     que responde "primeira extensão com tamanho >= n" (first-fit) em O(log n);
+   - árvore 1, ordenada por (tamanho, início), que responde "menor extensão com
+     tamanho >= n" (best-fit) em O(log n).
+   Extensões vizinhas são fundidas ao liberar, então o índice nunca tem duas
+   extensões encostadas. A mesma estrutura atende a área de dados e a de swap. */
+
+#define POR_INICIO 0
+#define POR_TAMANHO 1
+
+typedef struct No
+{
+    int inicio;
+    int tamanho;
+    unsigned prioridade;
+    struct No *esq[2], *dir[2];
+    int maior; // Maior tamanho na subárvore da árvore por início
+} No;
+
+typedef struct Alocador
+{
+    No *raiz[2];
+    int primeiro, fim; // Faixa de blocos administrada: [primeiro, fim)
+    int num_extensoes;
+    long livres;
+    unsigned semente;
+} Alocador;
+
+unsigned alocador_aleatorio(Alocador *a)
+{
+    a->semente ^= a->semente << 13;
+    a->semente ^= a->semente >> 17;
+    a->semente ^= a->semente << 5;
+    return a->semente;
+}
+
+int no_menor(const No *a, const No *b, int t)
+{
+    if (t == POR_INICIO)
+        return a->inicio < b->inicio;
+    return a->tamanho < b->tamanho || (a->tamanho == b->tamanho && a->inicio < b->inicio);
+}
+
+void no_atualizar(No *n, int t)
+{
+    if (t != POR_INICIO)
+        return;
+    n->maior = n->tamanho;
+    if (n->esq[0] && n->esq[0]->maior > n->maior)
+        n->maior = n->esq[0]->maior;
+    if (n->dir[0] && n->dir[0]->maior > n->maior)
+        n->maior = n->dir[0]->maior;
+}
+
+// Separa 'raiz' em chaves menores que 'chave' (l) e as demais (r)
+void no_dividir(No *raiz, No *chave, int t, No **l, No **r)
+{
+    if (!raiz)
+    {
+        *l = *r = NULL;
+        return;
+    }
+    if (no_menor(raiz, chave, t))
+    {
+        no_dividir(raiz->dir[t], chave, t, &raiz->dir[t], r);
+        *l = raiz;
+    }
+    else
+    {
+        no_dividir(raiz->esq[t], chave, t, l, &raiz->esq[t]);
+        *r = raiz;
+    }
+    no_atualizar(raiz, t);
+}
+
+No *no_unir(No *l, No *r, int t)
+{
+    if (!l || !r)
+        return l ? l : r;
+    if (l->prioridade > r->prioridade)
+    {
+        l->dir[t] = no_unir(l->dir[t], r, t);
+        no_atualizar(l, t);
+        return l;
+    }
+    r->esq[t] = no_unir(l, r->esq[t], t);
+    no_atualizar(r, t);
+    return r;
+}
+
+No *no_inserir(No *raiz, No *n, int t)
+{
+    if (!raiz)
+    {
+        n->esq[t] = n->dir[t] = NULL;
+        no_atualizar(n, t);
+        return n;
+    }
+    if (n->prioridade > raiz->prioridade)
+    {
+        no_dividir(raiz, n, t, &n->esq[t], &n->dir[t]);
+        no_atualizar(n, t);
+        return n;
+    }
+    if (no_menor(n, raiz, t))
+        raiz->esq[t] = no_inserir(raiz->esq[t], n, t);
+    else
+        raiz->dir[t] = no_inserir(raiz->dir[t], n, t);
+    no_atualizar(raiz, t);
+    return raiz;
+}
+
+No *no_remover(No *raiz, No *n, int t)
+{
+    if (raiz == n)
+        return no_unir(n->esq[t], n->dir[t], t);
+    if (no_menor(n, raiz, t))
+        raiz->esq[t] = no_remover(raiz->esq[t], n, t);
+    else
+        raiz->dir[t] = no_remover(raiz->dir[t], n, t);
+    no_atualizar(raiz, t);
+    return raiz;
+}
+
+void alocador_inserir(Alocador *a, No *n)
+{
+    a->raiz[POR_INICIO] = no_inserir(a->raiz[POR_INICIO], n, POR_INICIO);
+    a->raiz[POR_TAMANHO] = no_inserir(a->raiz[POR_TAMANHO], n, POR_TAMANHO);
+}
+
+void alocador_remover(Alocador *a, No *n)
+{
+    a->raiz[POR_INICIO] = no_remover(a->raiz[POR_INICIO], n, POR_INICIO);
+    a->raiz[POR_TAMANHO] = no_remover(a->raiz[POR_TAMANHO], n, POR_TAMANHO);
+}
+
+// Extensão com o maior início <= bloco, ou NULL
+No *alocador_anterior(Alocador *a, int bloco)
+{
+    No *r = a->raiz[POR_INICIO], *candidato = NULL;
+    while (r)
+    {
+        if (r->inicio <= bloco)
+        {
+            candidato = r;
+            r = r->dir[POR_INICIO];
+        }
+        else
+            r = r->esq[POR_INICIO];
+    }
+    return candidato;
+}
+
+No *alocador_primeiro_encaixe(No *r, int n)
+{
+    while (r && r->maior >= n)
+    {
+        if (r->esq[POR_INICIO] && r->esq[POR_INICIO]->maior >= n)
+            r = r->esq[POR_INICIO];
+        else if (r->tamanho >= n)
+            return r;
+        else
+            r = r->dir[POR_INICIO];
+    }
+    return NULL;
+}
+
+No *alocador_melhor_encaixe(No *r, int n)
+{
+    No *candidato = NULL;
+    while (r)
+    {
+        if (r->tamanho >= n)
+        {
+            candidato = r;
+            r = r->esq[POR_TAMANHO];
+        }
+        else
+            r = r->dir[POR_TAMANHO];
+    }
+    return candidato;
+}
+
+// Cria um alocador para os blocos [primeiro, fim), inicialmente todos ocupados
+Alocador *alocador_criar(int primeiro, int fim)
+{
+    Alocador *a = calloc(1, sizeof(Alocador));
+    a->primeiro = primeiro;
+    a->fim = fim;
+    a->semente = 2463534242u;
+    return a;
+}
+
+void alocador_destruir_no(No *n)
+{
+    if (!n)
+        return;
+    alocador_destruir_no(n->esq[POR_INICIO]);
+    alocador_destruir_no(n->dir[POR_INICIO]);
+    free(n);
+}
+
+void alocador_destruir(Alocador *a)
+{
+    alocador_destruir_no(a->raiz[POR_INICIO]);
+    free(a);
+}
+
+// Devolve [inicio, inicio + n) ao índice, fundindo com as extensões vizinhas
+void alocador_liberar(Alocador *a, int inicio, int n)
+{
+    if (n <= 0)
+        return;
+    a->livres += n;
+
+    No *antes = alocador_anterior(a, inicio - 1);
+    if (antes && antes->inicio + antes->tamanho == inicio)
+    {
+        alocador_remover(a, antes);
+        inicio = antes->inicio;
+        n += antes->tamanho;
+        free(antes);
+        a->num_extensoes--;
+    }
+    No *depois = alocador_anterior(a, inicio + n);
+    if (depois && depois->inicio == inicio + n)
+    {
+        alocador_remover(a, depois);
+        n += depois->tamanho;
+        free(depois);
+        a->num_extensoes--;
+    }
+
+    No *novo = calloc(1, sizeof(No));
+    novo->inicio = inicio;
+    novo->tamanho = n;
+    novo->prioridade = alocador_aleatorio(a);
+    alocador_inserir(a, novo);
+    a->num_extensoes++;
+}
+
+/* Reserva n blocos contíguos e devolve o primeiro, ou -1 se nenhuma extensão
+   comporta. 'melhor_encaixe' escolhe best-fit; senão, first-fit. */
+int alocador_reservar(Alocador *a, int n, int melhor_encaixe)
+{
+    if (n <= 0)
+        return -1;
+    No *e = melhor_encaixe ? alocador_melhor_encaixe(a->raiz[POR_TAMANHO], n)
+                           : alocador_primeiro_encaixe(a->raiz[POR_INICIO], n);
+    if (!e)
+        return -1;
+
+    int inicio = e->inicio;
+    alocador_remover(a, e);
+    if (e->tamanho == n)
+    {
+        free(e);
+        a->num_extensoes--;
+    }
+    else
+    {
+        e->inicio += n;
+        e->tamanho -= n;
+        alocador_inserir(a, e);
+    }
+    a->livres -= n;
+    return inicio;
+}
+
+// Reserva exatamente [inicio, inicio + n), que precisa estar livre; 0 ou -1
+int alocador_reservar_em(Alocador *a, int inicio, int n)
+{
+    No *e = alocador_anterior(a, inicio);
+    if (n <= 0 || !e || e->inicio + e->tamanho < inicio + n)
+        return -1;
+
+    int fim = e->inicio + e->tamanho;
+    alocador_remover(a, e);
+    a->num_extensoes--;
+    a->livres -= n;
+    if (inicio > e->inicio)
+    {
+        e->tamanho = inicio - e->inicio;
+        alocador_inserir(a, e);
+        a->num_extensoes++;
+        e = NULL;
+    }
+    if (fim > inicio + n)
+    {
+        No *resto = e ? e : calloc(1, sizeof(No));
+        resto->inicio = inicio + n;
+        resto->tamanho = fim - inicio - n;
+        resto->prioridade = alocador_aleatorio(a);
+        alocador_inserir(a, resto);
+        a->num_extensoes++;
+        e = NULL;
+    }
+    free(e);
+    return 0;
+}
+
+long alocador_livres(Alocador *a)
+{
+    return a->livres;
+}
+
+int alocador_maior_extensao(Alocador *a)
+{
+    return a->raiz[POR_INICIO] ? a->raiz[POR_INICIO]->maior : 0;
+}
+
+int alocador_num_extensoes(Alocador *a)
+{
+    return a->num_extensoes;
+}
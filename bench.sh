@@ -0,0 +1,117 @@
+#!/bin/sh
+# Bancada de medição do mini sistema (make bench).
+# Roda criar, ordenar, ler, concatenar e apagar para cada combinação de ocupação do
+# disco, distribuição da entrada e tamanho de arquivo, e escreve em JSON o tempo de
+# parede, os bytes lidos/gravados no disco de cada operação e a vazão em MB/s que sai
+# deles. Uma operação que falha não vira resultado: é avisada na saída de erro, e o
+# script termina com status 1 depois de medir o resto.
+# Tudo roda em um diretório temporário (o disco_virtual.img do usuário não é tocado)
+# e com semente fixa, então duas execuções medem exatamente as mesmas entradas.
+#
+# Parâmetros (variáveis de ambiente, listas separadas por espaço):
+#   BENCH_TAMANHOS       números por arquivo (padrão: abaixo, igual e muito acima
+#                        da CAPACIDADE da huge page, que é 524288 números)
+#   BENCH_DISTRIBUICOES  aleatoria, ordenada, reversa, repetida
+#   BENCH_OCUPACOES      % da área de dados ocupada antes das medições
+#   BENCH_ALGORITMO      algoritmo da ordenação (padrão: radix)
+#   BENCH_THREADS        threads da ordenação e da criação (padrão: 1)
+#   BENCH_SEMENTE        semente do gerador (padrão: 1)
+#   BENCH_DIRETO         1 para medir com E/S direta (O_DIRECT; padrão: 0)
+set -e
+
+BINARIO="$(cd "$(dirname "$0")" && pwd)/mini_sistema"
+TAMANHOS=${BENCH_TAMANHOS:-"100000 524288 4194304 16777216"}
+DISTRIBUICOES=${BENCH_DISTRIBUICOES:-"aleatoria ordenada reversa repetida"}
+OCUPACOES=${BENCH_OCUPACOES:-"0 50 90"}
+ALGORITMO=${BENCH_ALGORITMO:-radix}
+THREADS=${BENCH_THREADS:-1}
+SEMENTE=${BENCH_SEMENTE:-1}
+DIRETO=${BENCH_DIRETO:-0}
+
+# Números que cabem na área de dados (disco de 1 GB menos 100 MB de swap)
+AREA_DADOS=$(((1073741824 - 104857600) / 4))
+
+if [ ! -x "$BINARIO" ]; then
+    echo "Compile antes com make." >&2
+    exit 1
+fi
+
+FALHAS=0
+DIR=$(mktemp -d)
+trap 'rm -rf "$DIR"' EXIT INT TERM
+cd "$DIR"
+
+# O maior teste precisa de espaço para dois arquivos (a concatenação)
+MAIOR=0
+for t in $TAMANHOS; do
+    if [ "$t" -gt "$MAIOR" ]; then MAIOR=$t; fi
+done
+LIVRE_MINIMO=$((2 * MAIOR + AREA_DADOS / 100))
+
+for ocupacao in $OCUPACOES; do
+    enchimento=$((AREA_DADOS / 100 * ocupacao))
+    if [ $((AREA_DADOS - enchimento)) -lt "$LIVRE_MINIMO" ]; then enchimento=$((AREA_DADOS - LIVRE_MINIMO)); fi
+    if [ "$enchimento" -lt 0 ]; then enchimento=0; fi
+
+    # Um processo por nível de ocupação: o enchimento é criado uma vez só
+    rm -f disco_virtual.img
+    {
+        echo "semente $SEMENTE"
+        echo "algoritmo $ALGORITMO"
+        echo "threads $THREADS"
+        echo "direto $DIRETO"
+        if [ "$enchimento" -gt 0 ]; then echo "criar enchimento $enchimento"; fi
+        for distribuicao in $DISTRIBUICOES; do
+            echo "distribuicao $distribuicao"
+            for tamanho in $TAMANHOS; do
+                echo "criar a $tamanho"
+                echo "ordenar a"
+                echo "ler a 0 $((tamanho < 100 ? tamanho - 1 : 99))"
+                echo "criar b $tamanho"
+                echo "concatenar a b"
+                echo "apagar a"
+            done
+        done
+    } > comandos.txt
+
+    # O status do binário não importa aqui: cada comando traz o seu na linha JSON
+    if ! "$BINARIO" -q -f comandos.txt | awk -v ocupacao="$((enchimento * 100 / AREA_DADOS))" \
+        -v algoritmo="$ALGORITMO" -v threads="$THREADS" -v direto="$DIRETO" '
+        function campo(nome,    r) {
+            if (!match($0, "\"" nome "\":[0-9.]+"))
+                return 0;
+            r = substr($0, RSTART, RLENGTH);
+            sub(/^[^:]*:/, "", r);
+            return r + 0;
+        }
+        /^\{"n"/ {
+            match($0, /"comando":"[^"]*"/);
+            split(substr($0, RSTART + 11, RLENGTH - 12), p, " ");
+            if (p[1] == "distribuicao") { distribuicao = p[2]; next }
+            if (p[1] == "criar" && p[2] == "a") tamanho = p[3];
+            if (!match($0, /"status":"ok"/)) {
+                printf "Falhou (ocupação %d%%, %s, %d números): %s\n", ocupacao, distribuicao, tamanho, $0 > "/dev/stderr";
+                falhas++;
+                next;
+            }
+            if (p[1] == "semente" || p[1] == "algoritmo" || p[1] == "threads" || p[1] == "direto" || p[2] == "enchimento") next;
+
+            # Vazão pelos bytes que o próprio comando leu e gravou no disco
+            bytes = campo("bytes_lidos") + campo("bytes_escritos");
+            ms = campo("ms");
+            sub(/^\{"n":[0-9]+,/, "");
+            printf "{\"ocupacao\":%d,\"distribuicao\":\"%s\",\"elementos\":%d,\"algoritmo\":\"%s\",\"threads\":%d,\"direto\":%d,\"operacao\":\"%s\",\"mb_s\":%.2f,%s\n",
+                   ocupacao, distribuicao, tamanho, algoritmo, threads, direto, p[1], (ms > 0 ? bytes / 1e6 / (ms / 1000) : 0), $0;
+        }
+        END { exit falhas > 0 }' >> resultados.jsonl; then
+        FALHAS=1
+    fi
+done
+
+# Junta tudo em um documento JSON
+printf '{"versao":"%s","data":"%s","cpus":%s,"resultados":[\n' \
+    "$(git -C "$(dirname "$BINARIO")" describe --always --dirty 2>/dev/null || echo desconhecida)" \
+    "$(date -u +%Y-%m-%dT%H:%M:%SZ)" "$(nproc 2>/dev/null || echo 1)"
+sed '$!s/$/,/' resultados.jsonl
+printf ']}\n'
+exit $FALHAS
@@ -0,0 +1,293 @@
+#define _GNU_SOURCE // Deve vir antes de qualquer include
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <sys/types.h>
+
+/* Cache de blocos do disco, com escrita adiada (write-back).
+   Os quadros têm o tamanho de um bloco e ficam em uma área só; uma tabela hash pelo
+   número do bloco (listas encadeadas de índices de quadros) acha o quadro de um bloco.
+   O despejo segue o relógio (CLOCK, uma aproximação do LRU): cada acesso liga o bit
+   de referência do quadro, e o ponteiro gira pelos quadros desligando os bits até
+   achar um desligado. Um bloco escrito fica sujo no quadro e só vai para o disco ao
+   ser despejado ou em cache_sincronizar. Um mutex protege tudo, porque as threads da
+   ordenação também passam por aqui. */
+
+#define CACHE_BLOCO 4096 // Igual ao BLOCK_SIZE do disco
+#define CACHE_MAX_QUADROS 65536
+#define SEM_QUADRO (-1)
+
+typedef struct
+{
+    long bloco;   // Bloco do disco guardado no quadro (-1: quadro livre)
+    int proximo;  // Próximo quadro da mesma lista da tabela hash
+    char sujo;    // Modificado desde a última gravação
+    char referenciado;
+} Quadro;
+
+int cache_fd = -1;
+int cache_quadros = 0; // 0: cache desligado
+int cache_baldes;      // Listas da tabela hash (potência de 2)
+Quadro *quadros;
+int *cache_tabela;
+char *cache_dados;
+int cache_ponteiro; // Ponteiro do relógio
+pthread_mutex_t cache_mutex = PTHREAD_MUTEX_INITIALIZER;
+
+// Declarações externas dos contadores de desempenho (implementados em estatisticas.c)
+extern long estat_agora();
+extern void estat_es(int escrita, size_t bytes, long ns);
+extern void estat_cache(int acerto);
+extern void estat_cache_despejo(int gravado);
+
+// Declarações externas da saída dos comandos (implementada em servidor.c)
+extern void mostrar(const char *formato, ...);
+
+int *balde_do_bloco(long bloco)
+{
+    return &cache_tabela[(unsigned long)bloco * 2654435761u & (cache_baldes - 1)];
+}
+
+int procurar_quadro(long bloco)
+{
+    for (int q = *balde_do_bloco(bloco); q != SEM_QUADRO; q = quadros[q].proximo)
+        if (quadros[q].bloco == bloco)
+            return q;
+    return SEM_QUADRO;
+}
+
+void tirar_da_tabela(int q)
+{
+    int *p = balde_do_bloco(quadros[q].bloco);
+    while (*p != q)
+        p = &quadros[*p].proximo;
+    *p = quadros[q].proximo;
+    quadros[q].bloco = -1;
+    quadros[q].sujo = 0;
+}
+
+// Grava o quadro no disco se estiver sujo; 0 ou -1
+int gravar_quadro(int q)
+{
+    if (!quadros[q].sujo)
+        return 0;
+    long inicio = estat_agora();
+    ssize_t r = pwrite(cache_fd, cache_dados + (size_t)q * CACHE_BLOCO, CACHE_BLOCO,
+                       (off_t)quadros[q].bloco * CACHE_BLOCO);
+    if (r != CACHE_BLOCO)
+    {
+        perror("Erro ao gravar bloco do cache");
+        return -1;
+    }
+    estat_es(1, CACHE_BLOCO, estat_agora() - inicio);
+    quadros[q].sujo = 0;
+    return 0;
+}
+
+// Escolhe o quadro a reusar pelo relógio, gravando-o antes se estiver sujo
+int despejar_quadro()
+{
+    while (1)
+    {
+        int q = cache_ponteiro;
+        cache_ponteiro = (cache_ponteiro + 1) % cache_quadros;
+        if (quadros[q].bloco == -1)
+            return q;
+        if (quadros[q].referenciado)
+        {
+            quadros[q].referenciado = 0;
+            continue;
+        }
+        estat_cache_despejo(quadros[q].sujo);
+        if (gravar_quadro(q) == -1)
+            return SEM_QUADRO;
+        tirar_da_tabela(q);
+        return q;
+    }
+}
+
+/* Quadro com o bloco 'bloco'. Numa falta, o bloco só é lido do disco se 'carregar'
+   (quem vai sobrescrever o bloco inteiro não precisa do conteúdo antigo). */
+int obter_quadro(long bloco, int carregar)
+{
+    int q = procurar_quadro(bloco);
+    estat_cache(q != SEM_QUADRO);
+    if (q == SEM_QUADRO)
+    {
+        q = despejar_quadro();
+        if (q == SEM_QUADRO)
+            return SEM_QUADRO;
+        if (carregar)
+        {
+            long inicio = estat_agora();
+            if (pread(cache_fd, cache_dados + (size_t)q * CACHE_BLOCO, CACHE_BLOCO, (off_t)bloco * CACHE_BLOCO) !=
+                CACHE_BLOCO)
+            {
+                perror("Erro ao ler bloco para o cache");
+                return SEM_QUADRO;
+            }
+            estat_es(0, CACHE_BLOCO, estat_agora() - inicio);
+        }
+        int *balde = balde_do_bloco(bloco);
+        quadros[q] = (Quadro){bloco, *balde, 0, 0};
+        *balde = q;
+    }
+    quadros[q].referenciado = 1;
+    return q;
+}
+
+int cache_ativo()
+{
+    return cache_quadros > 0;
+}
+
+// Lê ou grava [pos, pos + len) do disco pelo cache; devolve 'len' ou -1
+ssize_t cache_transferir(void *buf, size_t len, off_t pos, int escrita)
+{
+    pthread_mutex_lock(&cache_mutex);
+    size_t feitos = 0;
+    while (feitos < len)
+    {
+        long bloco = (pos + feitos) / CACHE_BLOCO;
+        size_t desloc = (pos + feitos) % CACHE_BLOCO;
+        size_t n = CACHE_BLOCO - desloc < len - feitos ? CACHE_BLOCO - desloc : len - feitos;
+        int q = obter_quadro(bloco, !escrita || n < CACHE_BLOCO);
+        if (q == SEM_QUADRO)
+        {
+            pthread_mutex_unlock(&cache_mutex);
+            return -1;
+        }
+        char *dados = cache_dados + (size_t)q * CACHE_BLOCO + desloc;
+        if (escrita)
+        {
+            memcpy(dados, (char *)buf + feitos, n);
+            quadros[q].sujo = 1;
+        }
+        else
+            memcpy((char *)buf + feitos, dados, n);
+        feitos += n;
+    }
+    pthread_mutex_unlock(&cache_mutex);
+    return len;
+}
+
+/* Aplica 'acao' aos quadros dos blocos [primeiro, primeiro + n): procura bloco a
+   bloco quando a faixa é menor que o cache, senão percorre os quadros. */
+void percorrer_faixa(long primeiro, long n, void (*acao)(int q))
+{
+    if (n < cache_quadros)
+    {
+        for (long b = primeiro; b < primeiro + n; b++)
+        {
+            int q = procurar_quadro(b);
+            if (q != SEM_QUADRO)
+                acao(q);
+        }
+        return;
+    }
+    for (int q = 0; q < cache_quadros; q++)
+        if (quadros[q].bloco >= primeiro && quadros[q].bloco < primeiro + n)
+            acao(q);
+}
+
+void gravar_e_manter(int q)
+{
+    gravar_quadro(q);
+}
+
+void gravar_e_tirar(int q)
+{
+    gravar_quadro(q);
+    tirar_da_tabela(q);
+}
+
+/* Uma transferência vai direto ao disco em [pos, pos + len): os blocos sujos da
+   faixa são gravados antes e, se ela for uma escrita ('invalidar'), saem do cache. */
+void cache_antes_de_contornar(off_t pos, size_t len, int invalidar)
+{
+    if (!cache_ativo() || len == 0)
+        return;
+    pthread_mutex_lock(&cache_mutex);
+    long primeiro = pos / CACHE_BLOCO;
+    percorrer_faixa(primeiro, (pos + len - 1) / CACHE_BLOCO - primeiro + 1,
+                    invalidar ? gravar_e_tirar : gravar_e_manter);
+    pthread_mutex_unlock(&cache_mutex);
+}
+
+// Os blocos [inicio, inicio + n) foram liberados: saem do cache sem ser gravados
+void cache_descartar_blocos(long inicio, long n)
+{
+    if (!cache_ativo() || n <= 0)
+        return;
+    pthread_mutex_lock(&cache_mutex);
+    percorrer_faixa(inicio, n, tirar_da_tabela);
+    pthread_mutex_unlock(&cache_mutex);
+}
+
+// Grava todos os blocos sujos (os quadros continuam no cache)
+void cache_sincronizar()
+{
+    if (!cache_ativo())
+        return;
+    pthread_mutex_lock(&cache_mutex);
+    for (int q = 0; q < cache_quadros; q++)
+        if (quadros[q].bloco != -1)
+            gravar_quadro(q);
+    pthread_mutex_unlock(&cache_mutex);
+}
+
+/* Troca o cache por um de 'num_quadros' quadros (0 desliga), gravando antes o que
+   estiver sujo; 'fd' é o disco. -1 se o tamanho for inválido ou faltar memória (o
+   cache antigo é desfeito mesmo assim). */
+int cache_configurar(int fd, int num_quadros)
+{
+    if (num_quadros < 0 || num_quadros > CACHE_MAX_QUADROS)
+    {
+        mostrar("Tamanho de cache inválido (0 a %d blocos).\n", CACHE_MAX_QUADROS);
+        return -1;
+    }
+    cache_sincronizar();
+    pthread_mutex_lock(&cache_mutex);
+    free(quadros);
+    free(cache_tabela);
+    free(cache_dados);
+    quadros = NULL;
+    cache_tabela = NULL;
+    cache_dados = NULL;
+    cache_quadros = 0;
+    cache_fd = fd;
+
+    int resultado = 0;
+    if (num_quadros > 0)
+    {
+        cache_baldes = 1;
+        while (cache_baldes < 2 * num_quadros)
+            cache_baldes *= 2;
+        quadros = malloc(num_quadros * sizeof(Quadro));
+        cache_tabela = malloc(cache_baldes * sizeof(int));
+        if (!quadros || !cache_tabela ||
+            posix_memalign((void **)&cache_dados, CACHE_BLOCO, (size_t)num_quadros * CACHE_BLOCO) != 0)
+        {
+            perror("Erro ao alocar o cache de blocos");
+            free(quadros);
+            free(cache_tabela);
+            quadros = NULL;
+            cache_tabela = NULL;
+            cache_dados = NULL;
+            resultado = -1;
+        }
+        else
+        {
+            for (int q = 0; q < num_quadros; q++)
+                quadros[q] = (Quadro){-1, SEM_QUADRO, 0, 0};
+            for (int b = 0; b < cache_baldes; b++)
+                cache_tabela[b] = SEM_QUADRO;
+            cache_ponteiro = 0;
+            cache_quadros = num_quadros;
+        }
+    }
+    pthread_mutex_unlock(&cache_mutex);
+    return resultado;
+}
\ No newline at end of file
@@ -0,0 +1,145 @@
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+
+/* Compactação de blocos de inteiros de 32 bits.
+   Cada bloco (até 1024 números) vira um cabeçalho de 8 bytes e os números reduzidos
+   a 'bits' bits cada. Blocos em ordem crescente guardam diferenças (delta): cada
+   número menos o que está VIAS_COMPACTACAO posições antes, e os primeiros menos o
+   primeiro do bloco. Os demais guardam a distância até o menor do bloco (frame of
+   reference). O empacotamento é "vertical": o número i vai para a via i % VIAS e cada
+   via empilha os seus em palavras de 32 bits próprias, intercaladas com as das outras.
+   Assim todas as vias usam o mesmo deslocamento a cada passo e os laços internos, sem
+   dependência entre as vias, são vetorizados pelo compilador (como no gerador); até a
+   volta do delta é uma soma por via, não uma soma de prefixos serial. */
+
+#define VIAS_COMPACTACAO 8
+#define MAX_NUMEROS_BLOCO 1024
+
+#define BLOCO_REFERENCIA 0 // Distância até o menor do bloco
+#define BLOCO_DELTA 1      // Diferença para o número VIAS_COMPACTACAO posições antes
+
+typedef struct
+{
+    uint8_t tipo;
+    uint8_t bits;
+    uint16_t numeros;
+    int32_t referencia; // Menor do bloco (referência) ou primeiro do bloco (delta)
+} CabecalhoBloco;
+
+// Palavras de 32 bits por via para 'por_via' números de 'bits' bits
+int palavras_por_via(int por_via, int bits)
+{
+    return (por_via * bits + 31) / 32;
+}
+
+void empacotar(const uint32_t *v, int por_via, int bits, uint32_t *saida)
+{
+    memset(saida, 0, (size_t)palavras_por_via(por_via, bits) * VIAS_COMPACTACAO * sizeof(uint32_t));
+    if (bits == 0)
+        return;
+    for (int j = 0; j < por_via; j++)
+    {
+        int bit = j * bits, palavra = bit / 32, desloc = bit % 32;
+        uint32_t *atual = saida + palavra * VIAS_COMPACTACAO;
+        for (int l = 0; l < VIAS_COMPACTACAO; l++)
+            atual[l] |= v[j * VIAS_COMPACTACAO + l] << desloc;
+        if (desloc + bits > 32)
+            for (int l = 0; l < VIAS_COMPACTACAO; l++)
+                atual[VIAS_COMPACTACAO + l] |= v[j * VIAS_COMPACTACAO + l] >> (32 - desloc);
+    }
+}
+
+void desempacotar(const uint32_t *entrada, int por_via, int bits, uint32_t *v)
+{
+    if (bits == 0)
+    {
+        memset(v, 0, (size_t)por_via * VIAS_COMPACTACAO * sizeof(uint32_t));
+        return;
+    }
+    uint32_t mascara = bits == 32 ? 0xFFFFFFFFu : (1u << bits) - 1;
+    for (int j = 0; j < por_via; j++)
+    {
+        int bit = j * bits, palavra = bit / 32, desloc = bit % 32;
+        const uint32_t *atual = entrada + palavra * VIAS_COMPACTACAO;
+        if (desloc + bits > 32)
+            for (int l = 0; l < VIAS_COMPACTACAO; l++)
+                v[j * VIAS_COMPACTACAO + l] =
+                    ((atual[l] >> desloc) | (atual[VIAS_COMPACTACAO + l] << (32 - desloc))) & mascara;
+        else
+            for (int l = 0; l < VIAS_COMPACTACAO; l++)
+                v[j * VIAS_COMPACTACAO + l] = (atual[l] >> desloc) & mascara;
+    }
+}
+
+// Maior tamanho (em bytes) de um bloco compactado de 'numeros' números
+size_t limite_bloco_compactado(int numeros)
+{
+    int por_via = (numeros + VIAS_COMPACTACAO - 1) / VIAS_COMPACTACAO;
+    return sizeof(CabecalhoBloco) + (size_t)palavras_por_via(por_via, 32) * VIAS_COMPACTACAO * sizeof(uint32_t);
+}
+
+/* Compacta v[0..n) (n <= MAX_NUMEROS_BLOCO) em 'saida', alinhada a 4 bytes; devolve
+   os bytes usados, sempre múltiplo de 8. */
+size_t compactar_bloco(const int32_t *v, int n, unsigned char *saida)
+{
+    uint32_t d[MAX_NUMEROS_BLOCO];
+    int por_via = (n + VIAS_COMPACTACAO - 1) / VIAS_COMPACTACAO;
+    CabecalhoBloco c = {BLOCO_DELTA, 0, (uint16_t)n, n > 0 ? v[0] : 0};
+
+    int crescente = 1;
+    int32_t menor = c.referencia;
+    for (int i = 1; i < n; i++)
+    {
+        crescente &= v[i] >= v[i - 1];
+        menor = v[i] < menor ? v[i] : menor;
+    }
+    if (!crescente)
+    {
+        c.tipo = BLOCO_REFERENCIA;
+        c.referencia = menor;
+    }
+
+    uint32_t maior = 0;
+    for (int i = 0; i < n; i++)
+    {
+        uint32_t base = (c.tipo == BLOCO_DELTA && i >= VIAS_COMPACTACAO) ? (uint32_t)v[i - VIAS_COMPACTACAO]
+                                                                         : (uint32_t)c.referencia;
+        d[i] = (uint32_t)v[i] - base;
+        maior |= d[i];
+    }
+    for (int i = n; i < por_via * VIAS_COMPACTACAO; i++)
+        d[i] = 0;
+    while (c.bits < 32 && (maior >> c.bits))
+        c.bits++;
+
+    memcpy(saida, &c, sizeof(c));
+    empacotar(d, por_via, c.bits, (uint32_t *)(saida + sizeof(c)));
+    return sizeof(c) + (size_t)palavras_por_via(por_via, c.bits) * VIAS_COMPACTACAO * sizeof(uint32_t);
+}
+
+// Descompacta um bloco em v (espaço para MAX_NUMEROS_BLOCO); devolve quantos números
+int descompactar_bloco(const unsigned char *entrada, int32_t *v)
+{
+    CabecalhoBloco c;
+    memcpy(&c, entrada, sizeof(c));
+    int por_via = (c.numeros + VIAS_COMPACTACAO - 1) / VIAS_COMPACTACAO;
+    uint32_t d[MAX_NUMEROS_BLOCO];
+    desempacotar((const uint32_t *)(entrada + sizeof(c)), por_via, c.bits, d);
+
+    uint32_t soma[VIAS_COMPACTACAO];
+    for (int l = 0; l < VIAS_COMPACTACAO; l++)
+        soma[l] = (uint32_t)c.referencia;
+    for (int j = 0; j < por_via; j++)
+    {
+        for (int l = 0; l < VIAS_COMPACTACAO; l++)
+        {
+            uint32_t x = soma[l] + d[j * VIAS_COMPACTACAO + l];
+            if (c.tipo == BLOCO_DELTA)
+                soma[l] = x;
+            d[j * VIAS_COMPACTACAO + l] = x;
+        }
+    }
+    memcpy(v, d, c.numeros * sizeof(int32_t));
+    return c.numeros;
+}
\ No newline at end of file
@@ -1,563 +1,4043 @@
+#define _GNU_SOURCE // Deve vir antes de qualquer include
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <errno.h>
 #include <fcntl.h>
 #include <unistd.h>
 #include <stdint.h>
+#include <limits.h>
 #include <time.h>
+#include <pthread.h>
 #include <sys/mman.h>
+#include <sys/stat.h>
 #include <linux/mman.h>
 
-#define DISK_SIZE 1073741824 // 1 GB
+#define DISK_SIZE_PADRAO 1073741824L // 1 GB (geometria de um disco novo)
 #define BLOCK_SIZE 4096
 #define FILE_NAME_SIZE 32
-#define MAX_FILES 1024
-#define SWAP_SIZE 104857600 // 100 MB para área de swap
+#define ELEMENTOS_POR_BLOCO ((int)(BLOCK_SIZE / sizeof(int32_t)))
+#define CAPACIDADE_INICIAL_DIRETORIO 1024 // Slots da tabela do diretório ao formatar
+#define SWAP_SIZE_PADRAO 104857600L // 100 MB para área de swap
+#define DISK_SIZE_MAXIMO ((int64_t)INT_MAX / 64 * 64 * BLOCK_SIZE) // Números de bloco cabem em int (~8 TB)
+
+// Geometria do disco montado, lida do superbloco
+#define TOTAL_BLOCOS ((int)(fs->sb.disk_size / BLOCK_SIZE))
+#define PRIMEIRO_BLOCO_SWAP ((int)((fs->sb.disk_size - fs->sb.swap_size) / BLOCK_SIZE))
+#define BLOCOS_METADADOS (fs->sb.primeiro_bloco_dados)
 
 // Definições para Huge Page
 #define HUGE_PAGE_SIZE (2 * 1024 * 1024)
-#define CAPACIDADE (HUGE_PAGE_SIZE / sizeof(uint32_t))
+#define CAPACIDADE (HUGE_PAGE_SIZE / sizeof(uint32_t)) // Elementos em uma huge page
+#define PAGINAS_RESERVA_PADRAO 1                       // Huge pages reservadas na inicialização
+
+// Declarações externas da reserva de huge pages (implementada em memoria.c)
+extern int memoria_iniciar(int paginas);
+extern void *memoria_alocar_maior(size_t *bytes);
+extern void memoria_liberar(void *p);
+extern void *memoria_obter(size_t bytes, size_t alinhamento);
+extern void memoria_devolver(void *p);
+
+// Declarações externas da E/S assíncrona (implementadas em es_assincrona.c)
+extern void es_iniciar();
+extern int es_ler(int fd, void *buf, size_t len, off_t off);
+extern int es_escrever(int fd, const void *buf, size_t len, off_t off);
+extern ssize_t es_aguardar(int ticket);
+
+// Declarações externas do cache de blocos (implementado em cache_blocos.c)
+extern int cache_configurar(int fd, int num_quadros);
+extern int cache_ativo();
+extern ssize_t cache_transferir(void *buf, size_t len, off_t pos, int escrita);
+extern void cache_antes_de_contornar(off_t pos, size_t len, int invalidar);
+extern void cache_descartar_blocos(long inicio, long n);
+extern void cache_sincronizar();
+
+// Declarações externas dos contadores de desempenho (implementados em estatisticas.c)
+extern long estat_agora();
+extern void estat_es(int escrita, size_t bytes, long ns);
+extern void estat_msync(size_t bytes, long ns);
+extern void estat_swap(int blocos, int resultado);
+extern void estat_runs(int runs);
+extern void estat_passada();
+extern void estat_intercalacao(long elementos, long ns);
+extern void *estat_operacao_corrente();
+extern void estat_adotar_operacao(void *operacao);
+
+// Declarações externas da saída dos comandos e das travas do modo servidor (implementadas em servidor.c)
+extern void mostrar(const char *formato, ...);
+extern int comando_exclusivo();
+#define REPETIR_EXCLUSIVO (-2) // O comando precisa rodar de novo com o sistema todo travado
+
+// Declarações externas da memória virtual paginada (implementadas em paginacao.c)
+typedef struct MemoriaVirtual MemoriaVirtual;
+typedef ssize_t (*FuncaoES)(void *contexto, void *buf, size_t len, off_t pos);
+extern MemoriaVirtual *mv_criar(void *memoria, size_t tam_memoria, int tam_pagina, long num_elementos,
+                                FuncaoES ler, FuncaoES escrever, void *contexto);
+extern void mv_destruir(MemoriaVirtual *mv);
+extern void mv_sincronizar(MemoriaVirtual *mv);
+extern int32_t mv_ler(MemoriaVirtual *mv, long i);
+extern void mv_escrever(MemoriaVirtual *mv, long i, int32_t valor);
+extern int32_t *mv_fixar(MemoriaVirtual *mv, long inicio, long n, int sujar);
+extern void mv_soltar(MemoriaVirtual *mv, long inicio, long n);
+extern long mv_elementos_por_pagina(MemoriaVirtual *mv);
+extern int mv_falhou(MemoriaVirtual *mv);
+extern void mv_exibir_contadores(MemoriaVirtual *mv);
+
+// Declaração externa do gerador de números (implementado em gerador.c)
+extern void gerador_preencher(uint32_t *v, size_t n, uint64_t semente, uint64_t fluxo);
 
-// Declarações externas para as funções de gerenciamento de huge page (implementadas em memoria.c)
-extern void *alocar_huge_page();
-extern void liberar_huge_page(void *page);
+// Declarações externas da compactação de blocos (implementadas em compactacao.c)
+extern size_t limite_bloco_compactado(int numeros);
+extern size_t compactar_bloco(const int32_t *v, int n, unsigned char *saida);
+extern int descompactar_bloco(const unsigned char *entrada, int32_t *v);
+
+// Declarações usadas antes da definição (mais abaixo neste arquivo)
+extern int threads_ordenacao;
+void executar_em_paralelo(void *(*funcao)(void *), void *args, size_t tam_arg, int n);
+ssize_t transferir_disco(void *buf, size_t n, off_t fisico, int escrita);
+void exibir_fragmentacao();
+
+// Declarações externas do índice de extensões livres (implementadas em alocador.c)
+typedef struct Alocador Alocador;
+extern Alocador *alocador_criar(int primeiro, int fim);
+extern void alocador_destruir(Alocador *a);
+extern void alocador_liberar(Alocador *a, int inicio, int n);
+extern int alocador_reservar(Alocador *a, int n, int melhor_encaixe);
+extern int alocador_maior_extensao(Alocador *a);
+extern int alocador_reservar_em(Alocador *a, int inicio, int n);
+extern long alocador_livres(Alocador *a);
+extern int alocador_num_extensoes(Alocador *a);
+
+/* Extensão de um arquivo: trecho de blocos contíguos no disco. Guarda os bytes do
+   arquivo que estão nela, a partir do início do primeiro bloco; só a última extensão
+   de cada arquivo original pode terminar no meio de um bloco, mas depois de uma
+   concatenação isso vale para qualquer uma. */
+#define MAX_EXTENSOES 16
 
-// Estrutura de um arquivo
 typedef struct
 {
-    char name[FILE_NAME_SIZE];
-    int size;        // Tamanho em bytes
     int start_block; // Bloco inicial no disco
+    int64_t bytes;   // Bytes do arquivo guardados nesta extensão
+} Extensao;
+
+// Estados de um slot do diretório
+#define ENTRADA_LIVRE 0   // Nunca usado: encerra a sondagem
+#define ENTRADA_USADA 1
+#define ENTRADA_APAGADA 2 // Lápide: a sondagem passa por ele, e ele pode ser reaproveitado
+
+// Formatos do conteúdo de um arquivo
+#define FORMATO_BRUTO 0      // Os números, um atrás do outro
+#define FORMATO_COMPACTADO 1 // Tabela de posições + blocos compactados
+
+// Estrutura de um arquivo: o conteúdo é a sequência das suas extensões
+typedef struct
+{
+    char name[FILE_NAME_SIZE];
+    int estado;
+    int num_extensoes;
+    int64_t size; // Tamanho em bytes
+    Extensao extensoes[MAX_EXTENSOES];
+    int ordenado;        // 1 depois de ordenar; qualquer escrita no conteúdo zera
+    int indice_bloco;    // Índice esparso: primeiro bloco no disco (-1 se não há)
+    int indice_entradas; // Uma entrada (a primeira chave) por bloco lógico do arquivo
+    int formato;         // FORMATO_BRUTO ou FORMATO_COMPACTADO (blocos compactados)
 } FileEntry;
 
-// Estrutura do sistema de arquivos
+// Superbloco: primeiro bloco do disco, identifica o formato e a geometria
+#define MAGICO_SUPERBLOCO 0x494E494D // "MINI"
+#define VERSAO_FORMATO 7
+
+typedef struct
+{
+    uint32_t magico;
+    uint32_t versao;
+    uint32_t block_size;
+    uint32_t capacidade_diretorio; // Slots da tabela do diretório (potência de 2)
+    int64_t disk_size;             // Escolhidos ao formatar
+    int64_t swap_size;             // (os últimos swap_size bytes do disco)
+    int32_t primeiro_bloco_dados;  // Primeiro bloco após os metadados
+    int32_t bloco_diretorio;       // Primeiro bloco da tabela do diretório
+    char reservado[BLOCK_SIZE - 40];
+} Superbloco;
+
+/* Estrutura do sistema de arquivos. É também o formato dos metadados no início do
+   disco: o disco é mapeado com mmap e 'fs' aponta direto para ele, então montar não
+   lê nada além das páginas que forem tocadas. O bitmap tem o tamanho do disco, então
+   os metadados ocupam os primeiros blocos_metadados(disk_size) blocos. */
 typedef struct
 {
-    FileEntry files[MAX_FILES];
-    int file_count;                          // Número de arquivos atualmente no sistema
-    int free_blocks[DISK_SIZE / BLOCK_SIZE]; // Bitmap de blocos livres
+    Superbloco sb;
+    int file_count;           // Número de arquivos atualmente no sistema
+    int entradas_apagadas;    // Lápides na tabela do diretório
+    uint64_t bitmap_blocos[]; // 1 bit por bloco, 1 = ocupado
 } FileSystem;
 
+/* O diretório é uma tabela hash de endereçamento aberto (sondagem linear pelo nome)
+   guardada em uma extensão da área de dados e mapeada à parte. Apagar deixa uma
+   lápide no slot, sem mover as outras entradas; quando arquivos mais lápides passam
+   de 3/4 da tabela, ela é reconstruída em outra extensão, com o dobro do tamanho se
+   preciso. Não há limite fixo de arquivos. */
+
 typedef struct
 {
     int start_block;
     int num_blocks;
-    int num_elements;
+    long num_elements;
+    long primeiro; // Primeiro elemento usado (segmentos da intercalação paralela)
+    int decrescente; // Run natural em ordem decrescente: lida de trás para frente
 } RunInfo;
 
-FileSystem fs;
+FileSystem *fs;
 int disk_fd;
+int disk_fd_direto = -1; // Mesmo disco aberto com O_DIRECT (-1: E/S direta desligada)
+unsigned char *blocos_sujos;   // Blocos de metadados a gravar
+FileEntry *diretorio;          // Tabela do diretório (mmap)
+unsigned char *diretorio_sujo; // Blocos da tabela a gravar
+
+// Geometria usada quando o disco for formatado (comando formatar)
+int64_t disk_size_formatacao = DISK_SIZE_PADRAO;
+int64_t swap_size_formatacao = SWAP_SIZE_PADRAO;
+
+/* Índices de extensões livres, reconstruídos do bitmap na montagem. A área de
+   swap não é persistida, então seu alocador não passa pelo bitmap. */
+Alocador *alocador_dados;
+Alocador *alocador_swap;
+int politica_alocacao = 0; // 0: first-fit, 1: best-fit
+
+/* No modo servidor vários comandos rodam ao mesmo tempo. As travas, de fora para
+   dentro:
+   - a do sistema (servidor.c): configuração, formatar e desfragmentar a pegam
+     exclusiva; os outros comandos, compartilhada;
+   - a de cada arquivo (servidor.c): exclusiva para quem muda o arquivo, compartilhada
+     para ler e buscar. Ela protege a entrada do diretório e o conteúdo;
+   - trava_metadados (aqui): bitmap, alocadores, sondagem e slots do diretório,
+     contadores do superbloco e blocos sujos. É recursiva porque as funções de
+     alocação chamam umas às outras.
+   Crescer o diretório remapeia a tabela e invalida as entradas que outros comandos
+   seguram, então só acontece com a trava do sistema exclusiva (REPETIR_EXCLUSIVO). */
+pthread_mutex_t trava_metadados = PTHREAD_RECURSIVE_MUTEX_INITIALIZER_NP;
 
 void verificar_config_hugepage()
 {
-    printf("\nERRO: Configuração necessária:\n");
-    printf("1. Reserve 1 Huge Page (2MB):\n");
-    printf("   sudo sysctl vm.nr_hugepages=1\n");
-    printf("2. Verifique permissões no diretório /dev/hugepages\n\n");
+    mostrar("\nERRO: Configuração necessária:\n");
+    mostrar("1. Reserve 1 Huge Page (2MB):\n");
+    mostrar("   sudo sysctl vm.nr_hugepages=1\n");
+    mostrar("2. Verifique permissões no diretório /dev/hugepages\n\n");
 }
 
-// Inicializa o sistema de arquivos
-void initialize_filesystem()
+// Blocos dos metadados (superbloco, contadores e bitmap) de um disco de 'disk_size' bytes
+int blocos_metadados(int64_t disk_size)
+{
+    int64_t palavras = (disk_size / BLOCK_SIZE + 63) / 64;
+    return (int)((sizeof(FileSystem) + palavras * sizeof(uint64_t) + BLOCK_SIZE - 1) / BLOCK_SIZE);
+}
+
+// Bytes (em blocos inteiros) da tabela do diretório com 'capacidade' slots
+size_t bytes_diretorio(uint32_t capacidade)
+{
+    return ((size_t)capacidade * sizeof(FileEntry) + BLOCK_SIZE - 1) / BLOCK_SIZE * BLOCK_SIZE;
+}
+
+/* Marca como modificados os blocos de metadados que contêm [ptr, ptr + len), seja
+   na região do superbloco/bitmap, seja na tabela do diretório */
+void marcar_metadados(const void *ptr, size_t len)
+{
+    pthread_mutex_lock(&trava_metadados);
+    const char *base = (const char *)fs;
+    unsigned char *sujos = blocos_sujos;
+    if (diretorio && (const char *)ptr >= (const char *)diretorio &&
+        (const char *)ptr < (const char *)diretorio + bytes_diretorio(fs->sb.capacidade_diretorio))
+    {
+        base = (const char *)diretorio;
+        sujos = diretorio_sujo;
+    }
+    size_t inicio = (const char *)ptr - base;
+    for (size_t b = inicio / BLOCK_SIZE; b <= (inicio + len - 1) / BLOCK_SIZE; b++)
+        sujos[b] = 1;
+    pthread_mutex_unlock(&trava_metadados);
+}
+
+void sincronizar_regiao(void *regiao, unsigned char *sujos, size_t blocos)
+{
+    for (size_t b = 0; b < blocos; b++)
+    {
+        if (!sujos[b])
+            continue;
+        long inicio = estat_agora();
+        if (msync((char *)regiao + b * BLOCK_SIZE, BLOCK_SIZE, MS_SYNC) != 0)
+            perror("Erro ao gravar metadados");
+        estat_msync(BLOCK_SIZE, estat_agora() - inicio);
+        sujos[b] = 0;
+    }
+}
+
+/* Grava no disco só os blocos de metadados modificados, um msync por bloco (antes,
+   os blocos de dados sujos do cache, para os metadados nunca apontarem para dados
+   que ainda não estão no disco) */
+void sincronizar_metadados()
+{
+    if (!fs)
+        return; // Disco desmontado por um formatar que falhou
+    pthread_mutex_lock(&trava_metadados);
+    cache_sincronizar();
+    if (diretorio)
+        sincronizar_regiao(diretorio, diretorio_sujo, bytes_diretorio(fs->sb.capacidade_diretorio) / BLOCK_SIZE);
+    sincronizar_regiao(fs, blocos_sujos, BLOCOS_METADADOS);
+    pthread_mutex_unlock(&trava_metadados);
+}
+
+// Marca [inicio, inicio + n) como ocupados ou livres no bitmap, uma palavra por vez
+void marcar_blocos(int inicio, int n, int ocupado)
+{
+    if (n <= 0)
+        return;
+    int fim = inicio + n;
+    for (int b = inicio; b < fim;)
+    {
+        int palavra = b / 64, bit = b % 64;
+        int qtd = (64 - bit < fim - b) ? 64 - bit : fim - b;
+        uint64_t mascara = (qtd == 64) ? ~0ULL : ((1ULL << qtd) - 1) << bit;
+        if (ocupado)
+            fs->bitmap_blocos[palavra] |= mascara;
+        else
+            fs->bitmap_blocos[palavra] &= ~mascara;
+        b += qtd;
+    }
+    marcar_metadados(&fs->bitmap_blocos[inicio / 64], ((fim - 1) / 64 - inicio / 64 + 1) * sizeof(uint64_t));
+}
+
+// Primeiro bloco em [inicio, fim) cujo bit vale 'ocupado', ou 'fim' se não houver
+int proximo_bloco(int inicio, int fim, int ocupado)
+{
+    int b = inicio;
+    while (b < fim)
+    {
+        uint64_t w = fs->bitmap_blocos[b / 64];
+        if (!ocupado)
+            w = ~w;
+        w &= ~0ULL << (b % 64); // Ignora os bits antes de b
+        if (w)
+        {
+            int achado = (b / 64) * 64 + __builtin_ctzll(w);
+            return achado < fim ? achado : fim;
+        }
+        b = (b / 64 + 1) * 64;
+    }
+    return fim;
+}
+
+// Reconstrói o índice de extensões livres da área de dados a partir do bitmap
+void montar_alocadores()
+{
+    if (alocador_dados)
+        alocador_destruir(alocador_dados);
+    if (alocador_swap)
+        alocador_destruir(alocador_swap);
+
+    alocador_dados = alocador_criar(fs->sb.primeiro_bloco_dados, PRIMEIRO_BLOCO_SWAP);
+    int b = fs->sb.primeiro_bloco_dados;
+    while (b < PRIMEIRO_BLOCO_SWAP)
+    {
+        int livre = proximo_bloco(b, PRIMEIRO_BLOCO_SWAP, 0);
+        int ocupado = proximo_bloco(livre, PRIMEIRO_BLOCO_SWAP, 1);
+        alocador_liberar(alocador_dados, livre, ocupado - livre);
+        b = ocupado;
+    }
+
+    alocador_swap = alocador_criar(PRIMEIRO_BLOCO_SWAP, TOTAL_BLOCOS);
+    alocador_liberar(alocador_swap, PRIMEIRO_BLOCO_SWAP, TOTAL_BLOCOS - PRIMEIRO_BLOCO_SWAP);
+}
+
+// Reserva n blocos contíguos na área de dados e marca no bitmap; -1 se não houver
+int alocar_blocos_dados(int n)
+{
+    pthread_mutex_lock(&trava_metadados);
+    int inicio = alocador_reservar(alocador_dados, n, politica_alocacao);
+    if (inicio != -1)
+        marcar_blocos(inicio, n, 1);
+    pthread_mutex_unlock(&trava_metadados);
+    return inicio;
+}
+
+/* Devolve n blocos da área de dados. O trecho também vira um buraco na imagem (o
+   arquivo do host é esparso): o espaço volta para o host, e ler ali dá zeros. */
+void liberar_blocos_dados(int inicio, int n)
+{
+    if (n <= 0)
+        return;
+    pthread_mutex_lock(&trava_metadados); // O buraco é aberto antes de outro comando poder reusar os blocos
+    marcar_blocos(inicio, n, 0);
+    alocador_liberar(alocador_dados, inicio, n);
+    cache_descartar_blocos(inicio, n); // Blocos sujos de dados mortos não são gravados
+    fallocate(disk_fd, FALLOC_FL_PUNCH_HOLE | FALLOC_FL_KEEP_SIZE, (off_t)inicio * BLOCK_SIZE,
+              (off_t)n * BLOCK_SIZE); // Sem suporte no sistema de arquivos do host, os blocos só ficam lá
+    pthread_mutex_unlock(&trava_metadados);
+}
+
+int blocos_extensao(const Extensao *e)
+{
+    return (e->bytes + BLOCK_SIZE - 1) / BLOCK_SIZE;
+}
+
+// Bytes que o conteúdo do arquivo ocupa nas extensões
+long bytes_no_disco(const FileEntry *f)
+{
+    long bytes = 0;
+    for (int e = 0; e < f->num_extensoes; e++)
+        bytes += f->extensoes[e].bytes;
+    return bytes;
+}
+
+// Devolve os blocos de todas as extensões do arquivo
+void liberar_arquivo(FileEntry *f)
+{
+    for (int e = 0; e < f->num_extensoes; e++)
+        liberar_blocos_dados(f->extensoes[e].start_block, blocos_extensao(&f->extensoes[e]));
+    f->num_extensoes = 0;
+}
+
+/* Reserva espaço para 'bytes' bytes no arquivo 'f'. Tenta uma extensão só; se o
+   disco estiver fragmentado demais para isso, junta as maiores extensões livres, até
+   MAX_EXTENSOES. Devolve -1 (sem reservar nada) se não couber. */
+int alocar_arquivo(FileEntry *f, long bytes)
+{
+    f->num_extensoes = 0;
+    if (bytes == 0)
+        return 0;
+
+    pthread_mutex_lock(&trava_metadados); // As maiores extensões livres não podem mudar no meio
+    int blocos = (bytes + BLOCK_SIZE - 1) / BLOCK_SIZE;
+    int inicio = alocar_blocos_dados(blocos);
+    if (inicio != -1)
+    {
+        f->extensoes[f->num_extensoes++] = (Extensao){inicio, bytes};
+        pthread_mutex_unlock(&trava_metadados);
+        return 0;
+    }
+
+    long restantes = bytes;
+    while (restantes > 0 && f->num_extensoes < MAX_EXTENSOES)
+    {
+        int maior = alocador_maior_extensao(alocador_dados);
+        if (maior == 0)
+            break;
+        blocos = (restantes + BLOCK_SIZE - 1) / BLOCK_SIZE;
+        if (blocos > maior)
+            blocos = maior;
+        inicio = alocar_blocos_dados(blocos);
+        long guardados = (long)blocos * BLOCK_SIZE < restantes ? (long)blocos * BLOCK_SIZE : restantes;
+        f->extensoes[f->num_extensoes++] = (Extensao){inicio, guardados};
+        restantes -= guardados;
+    }
+    if (restantes > 0)
+        liberar_arquivo(f);
+    pthread_mutex_unlock(&trava_metadados);
+    return restantes > 0 ? -1 : 0;
+}
+
+/* Índice esparso de um arquivo ordenado: a primeira chave de cada bloco lógico
+   (ELEMENTOS_POR_BLOCO elementos), montado pela ordenação enquanto grava a saída e
+   guardado em uma extensão própria da área de dados. Achar um valor custa uma busca
+   binária no índice e a leitura de um bloco do arquivo. */
+int blocos_indice(int entradas)
+{
+    return (entradas * sizeof(int32_t) + BLOCK_SIZE - 1) / BLOCK_SIZE;
+}
+
+// O conteúdo do arquivo vai mudar: deixa de ser ordenado e perde o índice
+void descartar_indice(FileEntry *f)
+{
+    if (f->indice_bloco >= 0)
+        liberar_blocos_dados(f->indice_bloco, blocos_indice(f->indice_entradas));
+    f->ordenado = 0;
+    f->indice_bloco = -1;
+    f->indice_entradas = 0;
+    marcar_metadados(f, sizeof(FileEntry));
+}
+
+// Marca o arquivo como ordenado e grava o índice (sem espaço, fica sem índice)
+void gravar_indice(FileEntry *f, const int32_t *indice, int entradas)
+{
+    descartar_indice(f);
+    f->ordenado = 1;
+    int blocos = blocos_indice(entradas);
+    int inicio = entradas > 0 ? alocar_blocos_dados(blocos) : -1;
+    if (inicio != -1)
+    {
+        ssize_t r = transferir_disco((void *)indice, entradas * sizeof(int32_t), (off_t)inicio * BLOCK_SIZE, 1);
+        if (r == (ssize_t)(entradas * sizeof(int32_t)))
+        {
+            f->indice_bloco = inicio;
+            f->indice_entradas = entradas;
+        }
+        else
+            liberar_blocos_dados(inicio, blocos);
+    }
+    marcar_metadados(f, sizeof(FileEntry));
+}
+
+/* E/S direta (opcional): com ela ligada, as transferências de dados que podem ir por
+   O_DIRECT (buffer e posição alinhados a BLOCK_SIZE, tamanho múltiplo de BLOCK_SIZE)
+   usam disk_fd_direto e não passam pelo page cache do host; a huge page já é alinhada
+   a 2 MB e as janelas da ordenação são recortadas em blocos inteiros, então quase todo
+   o tráfego se qualifica. O que não se qualifica (cauda de arquivo, segmentos da
+   intercalação paralela, metadados mapeados) segue pelo disk_fd normal; o kernel
+   mantém os dois caminhos coerentes. */
+int definir_es_direta(int ativa)
+{
+    if (disk_fd_direto >= 0)
+    {
+        close(disk_fd_direto);
+        disk_fd_direto = -1;
+    }
+    if (ativa)
+    {
+        disk_fd_direto = open("disco_virtual.img", O_RDWR | O_DIRECT);
+        if (disk_fd_direto < 0)
+        {
+            perror("E/S direta indisponível neste sistema de arquivos");
+            return -1;
+        }
+    }
+    mostrar("E/S direta (O_DIRECT): %s\n", ativa ? "ligada" : "desligada");
+    return 0;
+}
+
+// Quantos bytes do início de [buf, buf + n) podem ir por O_DIRECT para 'pos'
+size_t bytes_diretos(const void *buf, size_t n, off_t pos)
+{
+    if (disk_fd_direto < 0 || ((uintptr_t)buf | (uintptr_t)pos) % BLOCK_SIZE != 0)
+        return 0;
+    return n / BLOCK_SIZE * BLOCK_SIZE;
+}
+
+/* Pedido assíncrono de uma área da swap. Com E/S direta, o tamanho é arredondado
+   para cima até um bloco inteiro: quem chama garante que o buffer tem espaço e que o
+   bloco final pertence à mesma área (a swap é sempre reservada em blocos inteiros). */
+int es_swap(void *buf, size_t len, off_t pos, int escrita)
+{
+    size_t arredondado = (len + BLOCK_SIZE - 1) / BLOCK_SIZE * BLOCK_SIZE;
+    int fd = disk_fd;
+    if (len > 0 && bytes_diretos(buf, arredondado, pos) == arredondado)
+    {
+        fd = disk_fd_direto;
+        len = arredondado;
+    }
+    return escrita ? es_escrever(fd, buf, len, pos) : es_ler(fd, buf, len, pos);
+}
+
+// Dica ao kernel: as páginas de [inicio, inicio + len) do disco não serão mais usadas
+void descartar_cache(off_t inicio, off_t len)
+{
+    if (disk_fd_direto < 0)
+        posix_fadvise(disk_fd, inicio, len, POSIX_FADV_DONTNEED);
+}
+
+void descartar_cache_arquivo(const FileEntry *f)
+{
+    for (int e = 0; e < f->num_extensoes; e++)
+        descartar_cache((off_t)f->extensoes[e].start_block * BLOCK_SIZE, f->extensoes[e].bytes);
+}
+
+/* Traduz a posição lógica 'pos' do arquivo para um offset no disco; '*contiguos'
+   recebe quantos bytes seguem contíguos a partir dali. -1 se 'pos' passa do fim. */
+off_t traduzir_posicao(const FileEntry *f, off_t pos, off_t *contiguos)
 {
-    fs.file_count = 0;
-    memset(fs.files, 0, sizeof(fs.files));
-    memset(fs.free_blocks, 0, sizeof(fs.free_blocks));
+    for (int e = 0; e < f->num_extensoes; e++)
+    {
+        if (pos < f->extensoes[e].bytes)
+        {
+            *contiguos = f->extensoes[e].bytes - pos;
+            return (off_t)f->extensoes[e].start_block * BLOCK_SIZE + pos;
+        }
+        pos -= f->extensoes[e].bytes;
+    }
+    *contiguos = 0;
+    return -1;
+}
+
+/* Cache de blocos: os pedidos de até CACHE_LIMITE_PEDIDO bytes (trechos curtos lidos
+   por ler e buscar, caudas de arquivos, o índice esparso) passam pelo cache, que fica
+   com os blocos quentes. Os maiores (criação, ordenação, cópias) vão direto ao disco
+   para não expulsá-los: antes, os blocos sujos da faixa são gravados e, se o pedido
+   for uma escrita, saem do cache. Blocos liberados saem do cache sem ser gravados. */
+#define CACHE_LIMITE_PEDIDO (32 * 1024)
+#define CACHE_QUADROS_PADRAO 1024 // 4 MB
+
+int definir_cache_blocos(int quadros)
+{
+    if (cache_configurar(disk_fd, quadros) == -1)
+        return -1;
+    if (quadros > 0)
+        mostrar("Cache de blocos: %d blocos (%.1f MB)\n", quadros, (double)quadros * BLOCK_SIZE / (1024 * 1024));
+    else
+        mostrar("Cache de blocos: desligado\n");
+    return 0;
+}
+
+// Uma transferência contígua no disco; como pread/pwrite, pode fazer só uma parte
+ssize_t transferir_disco(void *buf, size_t n, off_t fisico, int escrita)
+{
+    if (cache_ativo() && n <= CACHE_LIMITE_PEDIDO)
+        return cache_transferir(buf, n, fisico, escrita);
+    cache_antes_de_contornar(fisico, n, escrita);
+    size_t diretos = bytes_diretos(buf, n, fisico);
+    int fd = diretos ? disk_fd_direto : disk_fd;
+    if (diretos)
+        n = diretos; // A cauda desalinhada vai na próxima chamada, pelo page cache
+    long inicio = estat_agora();
+    ssize_t r = escrita ? pwrite(fd, buf, n, fisico) : pread(fd, buf, n, fisico);
+    if (r > 0)
+        estat_es(escrita, r, estat_agora() - inicio);
+    return r;
+}
+
+// Lê ou grava [pos, pos + len) do arquivo, um pedido por extensão tocada
+ssize_t transferir_arquivo(const FileEntry *f, void *buf, size_t len, off_t pos, int escrita)
+{
+    size_t feitos = 0;
+    while (feitos < len)
+    {
+        off_t contiguos;
+        off_t fisico = traduzir_posicao(f, pos + feitos, &contiguos);
+        if (fisico < 0)
+            break;
+        size_t n = (off_t)(len - feitos) < contiguos ? len - feitos : (size_t)contiguos;
+        ssize_t r = transferir_disco((char *)buf + feitos, n, fisico, escrita);
+        if (r < 0)
+            return -1;
+        if (r == 0)
+            break;
+        feitos += r;
+    }
+    return feitos;
+}
+
+ssize_t ler_arquivo(void *arquivo, void *buf, size_t len, off_t pos)
+{
+    return transferir_arquivo(arquivo, buf, len, pos, 0);
+}
+
+ssize_t escrever_arquivo(void *arquivo, void *buf, size_t len, off_t pos)
+{
+    return transferir_arquivo(arquivo, buf, len, pos, 1);
+}
+
+/* Lote de E/S assíncrona: um pedido por extensão tocada (dois se a extensão tiver
+   uma cauda que não pode ir por O_DIRECT). Sem arquivo, 'pos' é um offset direto no
+   disco. */
+#define MAX_PEDIDOS_LOTE (2 * MAX_EXTENSOES)
+
+typedef struct
+{
+    int tickets[MAX_PEDIDOS_LOTE];
+    int n;
+} LoteES;
+
+void lote_enviar(LoteES *l, const FileEntry *f, void *buf, size_t len, off_t pos, int escrita)
+{
+    l->n = 0;
+    size_t feitos = 0;
+    while (feitos < len && l->n < MAX_PEDIDOS_LOTE)
+    {
+        off_t contiguos = len - feitos;
+        off_t fisico = f ? traduzir_posicao(f, pos + feitos, &contiguos) : pos + (off_t)feitos;
+        if (fisico < 0)
+            break;
+        size_t n = (off_t)(len - feitos) < contiguos ? len - feitos : (size_t)contiguos;
+        if (f)
+            cache_antes_de_contornar(fisico, n, escrita); // Arquivos podem ter blocos no cache
+        size_t diretos = bytes_diretos((char *)buf + feitos, n, fisico);
+        int fd = diretos ? disk_fd_direto : disk_fd;
+        if (diretos)
+            n = diretos;
+        l->tickets[l->n++] = escrita ? es_escrever(fd, (char *)buf + feitos, n, fisico)
+                                     : es_ler(fd, (char *)buf + feitos, n, fisico);
+        feitos += n;
+    }
+}
+
+// Espera todos os pedidos do lote; -1 se algum falhou
+int lote_aguardar(LoteES *l)
+{
+    int erro = 0;
+    for (int i = 0; i < l->n; i++)
+        if (es_aguardar(l->tickets[i]) < 0)
+            erro = 1;
+    l->n = 0;
+    return erro ? -1 : 0;
+}
+
+// Hash FNV-1a do nome
+uint32_t hash_nome(const char *nome)
+{
+    uint32_t h = 2166136261u;
+    for (int i = 0; i < FILE_NAME_SIZE && nome[i]; i++)
+        h = (h ^ (unsigned char)nome[i]) * 16777619u;
+    return h;
+}
+
+/* Sonda a tabela atrás de 'nome'. Com '*achado' = 1, devolve a entrada dele; senão,
+   o slot onde ele seria inserido (a primeira lápide do caminho, se houver). */
+FileEntry *sondar_diretorio(FileEntry *tabela, uint32_t capacidade, const char *nome, int *achado)
+{
+    uint32_t mascara = capacidade - 1;
+    FileEntry *lapide = NULL;
+    *achado = 0;
+    for (uint32_t i = hash_nome(nome) & mascara, passos = 0; passos < capacidade; i = (i + 1) & mascara, passos++)
+    {
+        FileEntry *e = &tabela[i];
+        if (e->estado == ENTRADA_LIVRE)
+            return lapide ? lapide : e;
+        if (e->estado == ENTRADA_APAGADA)
+        {
+            if (!lapide)
+                lapide = e;
+        }
+        else if (strncmp(e->name, nome, FILE_NAME_SIZE) == 0)
+        {
+            *achado = 1;
+            return e;
+        }
+    }
+    return lapide;
+}
+
+FileEntry *buscar_arquivo(const char *nome)
+{
+    int achado;
+    pthread_mutex_lock(&trava_metadados);
+    FileEntry *e = sondar_diretorio(diretorio, fs->sb.capacidade_diretorio, nome, &achado);
+    pthread_mutex_unlock(&trava_metadados);
+    return achado ? e : NULL;
+}
+
+FileEntry *mapear_diretorio(int bloco, uint32_t capacidade)
+{
+    FileEntry *tabela = mmap(NULL, bytes_diretorio(capacidade), PROT_READ | PROT_WRITE, MAP_SHARED,
+                             disk_fd, (off_t)bloco * BLOCK_SIZE);
+    return tabela == MAP_FAILED ? NULL : tabela;
+}
+
+/* Reconstrói o diretório em uma tabela nova de 'capacidade' slots, sem lápides.
+   A tabela nova é gravada antes de o superbloco apontar para ela; só então os
+   blocos da antiga são liberados. */
+int redimensionar_diretorio(uint32_t capacidade)
+{
+    size_t bytes = bytes_diretorio(capacidade);
+    int bloco = alocar_blocos_dados(bytes / BLOCK_SIZE);
+    if (bloco == -1)
+        return -1;
+    FileEntry *nova = mapear_diretorio(bloco, capacidade);
+    if (!nova)
+    {
+        perror("Erro ao mapear o diretório");
+        liberar_blocos_dados(bloco, bytes / BLOCK_SIZE);
+        return -1;
+    }
+    memset(nova, 0, bytes);
+
+    uint32_t capacidade_antiga = fs->sb.capacidade_diretorio;
+    for (uint32_t i = 0; diretorio && i < capacidade_antiga; i++)
+    {
+        if (diretorio[i].estado != ENTRADA_USADA)
+            continue;
+        int achado;
+        *sondar_diretorio(nova, capacidade, diretorio[i].name, &achado) = diretorio[i];
+    }
+    long inicio = estat_agora();
+    if (msync(nova, bytes, MS_SYNC) != 0)
+        perror("Erro ao gravar o diretório");
+    estat_msync(bytes, estat_agora() - inicio);
+
+    int bloco_antigo = fs->sb.bloco_diretorio;
+    if (diretorio)
+        munmap(diretorio, bytes_diretorio(capacidade_antiga));
+    free(diretorio_sujo);
+    diretorio = nova;
+    diretorio_sujo = calloc(bytes / BLOCK_SIZE, 1);
+
+    fs->sb.bloco_diretorio = bloco;
+    fs->sb.capacidade_diretorio = capacidade;
+    fs->entradas_apagadas = 0;
+    marcar_metadados(&fs->sb, sizeof(Superbloco));
+    marcar_metadados(&fs->entradas_apagadas, sizeof(int));
+    sincronizar_metadados();
+
+    if (capacidade_antiga > 0)
+        liberar_blocos_dados(bloco_antigo, bytes_diretorio(capacidade_antiga) / BLOCK_SIZE);
+    return 0;
+}
+
+// Verdadeiro se mais um arquivo passaria a tabela do diretório de 3/4 de ocupação
+int diretorio_precisa_crescer()
+{
+    return (uint64_t)(fs->file_count + fs->entradas_apagadas + 1) * 4 > (uint64_t)fs->sb.capacidade_diretorio * 3;
+}
+
+/* Slot para um arquivo novo chamado 'nome'; a tabela cresce (ou só perde as
+   lápides) antes de passar de 3/4 de ocupação. NULL se o nome já existe ou se não
+   há espaço para a tabela maior. O slot só passa a valer em ocupar_entrada. */
+FileEntry *reservar_entrada(const char *nome)
+{
+    uint32_t capacidade = fs->sb.capacidade_diretorio;
+    if (diretorio_precisa_crescer())
+    {
+        while ((uint64_t)(fs->file_count + 1) * 2 > capacidade)
+            capacidade *= 2;
+        if (redimensionar_diretorio(capacidade) == -1)
+        {
+            mostrar("Espaço insuficiente para aumentar o diretório.\n");
+            return NULL;
+        }
+    }
+
+    int achado;
+    FileEntry *e = sondar_diretorio(diretorio, capacidade, nome, &achado);
+    if (achado)
+    {
+        mostrar("Arquivo '%s' já existe.\n", nome);
+        return NULL;
+    }
+    return e;
+}
+
+void ocupar_entrada(FileEntry *e, const char *nome)
+{
+    pthread_mutex_lock(&trava_metadados);
+    if (e->estado == ENTRADA_APAGADA)
+    {
+        fs->entradas_apagadas--;
+        marcar_metadados(&fs->entradas_apagadas, sizeof(int));
+    }
+    strncpy(e->name, nome, FILE_NAME_SIZE);
+    e->estado = ENTRADA_USADA;
+    e->ordenado = 0;
+    e->indice_bloco = -1;
+    e->indice_entradas = 0;
+    e->formato = FORMATO_BRUTO;
+    marcar_metadados(e, sizeof(FileEntry));
+    fs->file_count++;
+    marcar_metadados(&fs->file_count, sizeof(int));
+    pthread_mutex_unlock(&trava_metadados);
+}
+
+// Tira a entrada do diretório: vira lápide, ou slot livre se a sondagem já parava ali
+void remover_entrada(FileEntry *e)
+{
+    pthread_mutex_lock(&trava_metadados);
+    uint32_t i = e - diretorio;
+    if (diretorio[(i + 1) & (fs->sb.capacidade_diretorio - 1)].estado == ENTRADA_LIVRE)
+        e->estado = ENTRADA_LIVRE;
+    else
+    {
+        e->estado = ENTRADA_APAGADA;
+        fs->entradas_apagadas++;
+        marcar_metadados(&fs->entradas_apagadas, sizeof(int));
+    }
+    marcar_metadados(e, sizeof(FileEntry));
+    fs->file_count--;
+    marcar_metadados(&fs->file_count, sizeof(int));
+    pthread_mutex_unlock(&trava_metadados);
+}
+
+/* Mapeia os metadados de um disco de 'disk_size' bytes. Se a imagem for menor, ela
+   cresce com ftruncate, que só muda o tamanho: o arquivo do host é esparso e os
+   blocos nunca gravados não ocupam espaço. 0 ou -1. */
+int mapear_metadados(int64_t disk_size)
+{
+    struct stat st;
+    if (fstat(disk_fd, &st) == -1 || (st.st_size < disk_size && ftruncate(disk_fd, disk_size) == -1))
+        return -1;
+    int blocos = blocos_metadados(disk_size);
+    fs = mmap(NULL, (size_t)blocos * BLOCK_SIZE, PROT_READ | PROT_WRITE, MAP_SHARED, disk_fd, 0);
+    if (fs == MAP_FAILED)
+    {
+        fs = NULL;
+        return -1;
+    }
+    blocos_sujos = calloc(blocos, 1);
+    if (!blocos_sujos)
+    {
+        munmap(fs, (size_t)blocos * BLOCK_SIZE);
+        fs = NULL;
+        return -1;
+    }
+    return 0;
+}
+
+// Verdadeiro se um disco de 'disk_size' bytes, com 'swap_size' de swap no fim, pode ser formatado
+int geometria_valida(int64_t disk_size, int64_t swap_size)
+{
+    if (disk_size <= 0 || disk_size > DISK_SIZE_MAXIMO || disk_size % BLOCK_SIZE != 0 || swap_size <= 0 ||
+        swap_size % BLOCK_SIZE != 0)
+        return 0;
+    int64_t blocos_dados = (disk_size - swap_size) / BLOCK_SIZE - blocos_metadados(disk_size);
+    return blocos_dados >= (int64_t)(bytes_diretorio(CAPACIDADE_INICIAL_DIRETORIO) / BLOCK_SIZE);
+}
+
+// Desfaz os mapeamentos do disco montado (antes de formatá-lo de novo)
+void desmontar_disco()
+{
+    if (!fs)
+        return;
+    cache_descartar_blocos(0, TOTAL_BLOCOS); // Nada do conteúdo antigo deve ser gravado
+    if (diretorio)
+        munmap(diretorio, bytes_diretorio(fs->sb.capacidade_diretorio));
+    munmap(fs, (size_t)BLOCOS_METADADOS * BLOCK_SIZE);
+    free(diretorio_sujo);
+    free(blocos_sujos);
+    diretorio = NULL;
+    diretorio_sujo = NULL;
+    blocos_sujos = NULL;
+    fs = NULL;
+}
+
+/* Inicializa o sistema de arquivos (formata os metadados) com a geometria dada. A
+   imagem é truncada antes: o conteúdo antigo vai embora e ela fica toda esparsa. */
+int initialize_filesystem(int64_t disk_size, int64_t swap_size)
+{
+    if (ftruncate(disk_fd, 0) == -1 || mapear_metadados(disk_size) == -1)
+        return -1;
+    fs->sb.magico = MAGICO_SUPERBLOCO;
+    fs->sb.versao = VERSAO_FORMATO;
+    fs->sb.block_size = BLOCK_SIZE;
+    fs->sb.disk_size = disk_size;
+    fs->sb.swap_size = swap_size;
+    fs->sb.primeiro_bloco_dados = blocos_metadados(disk_size);
+    fs->sb.bloco_diretorio = -1;
+
+    // Os blocos dos próprios metadados e os da área de swap (os últimos swap_size
+    // bytes do disco) nunca são alocados para arquivos
+    marcar_blocos(0, BLOCOS_METADADOS, 1);
+    marcar_blocos(PRIMEIRO_BLOCO_SWAP, TOTAL_BLOCOS - PRIMEIRO_BLOCO_SWAP, 1);
+    if (msync(fs, (size_t)BLOCOS_METADADOS * BLOCK_SIZE, MS_SYNC) != 0)
+        perror("Erro ao gravar metadados");
+    memset(blocos_sujos, 0, BLOCOS_METADADOS);
+
+    // A tabela do diretório é a primeira extensão da área de dados
+    montar_alocadores();
+    if (redimensionar_diretorio(CAPACIDADE_INICIAL_DIRETORIO) == -1)
+    {
+        mostrar("Não foi possível criar o diretório.\n");
+        desmontar_disco();
+        return -1;
+    }
+    return 0;
+}
+
+// Verdadeiro se o superbloco lido do disco descreve um disco no formato atual
+int superbloco_valido(const Superbloco *sb)
+{
+    return sb->magico == MAGICO_SUPERBLOCO && sb->versao == VERSAO_FORMATO && sb->block_size == BLOCK_SIZE &&
+           geometria_valida(sb->disk_size, sb->swap_size) &&
+           sb->primeiro_bloco_dados == blocos_metadados(sb->disk_size) &&
+           sb->capacidade_diretorio > 0 && (sb->capacidade_diretorio & (sb->capacidade_diretorio - 1)) == 0 &&
+           sb->bloco_diretorio >= sb->primeiro_bloco_dados &&
+           sb->bloco_diretorio < (sb->disk_size - sb->swap_size) / BLOCK_SIZE;
+}
+
+// Falso depois de um formatar que falhou: não há metadados para nenhum comando usar
+int disco_montado()
+{
+    return fs != NULL;
+}
+
+/* Comando formatar: apaga tudo e formata o disco com 'disco_mb' MB, dos quais os
+   últimos 'swap_mb' MB são a área de swap (a ordenação externa precisa de swap do
+   tamanho do arquivo). A geometria fica no superbloco e vale nas próximas execuções. */
+int formatar(long disco_mb, long swap_mb)
+{
+    int64_t disk_size = (int64_t)disco_mb * 1024 * 1024, swap_size = (int64_t)swap_mb * 1024 * 1024;
+    if (disco_mb <= 0 || disco_mb > DISK_SIZE_MAXIMO / (1024 * 1024) || swap_mb <= 0 ||
+        !geometria_valida(disk_size, swap_size))
+    {
+        mostrar("Geometria inválida (disco de até %ld MB, com a swap menor que ele).\n",
+               (long)(DISK_SIZE_MAXIMO / (1024 * 1024)));
+        return -1;
+    }
+
+    desmontar_disco();
+    disk_size_formatacao = disk_size;
+    swap_size_formatacao = swap_size;
+    if (initialize_filesystem(disk_size, swap_size) == -1)
+    {
+        // Fica sem disco montado: os outros comandos recusam até um formatar dar certo
+        mostrar("Erro ao formatar o disco: %s\n", strerror(errno));
+        return -1;
+    }
+    mostrar("Disco virtual formatado: %ld MB, dos quais %ld MB de swap.\n", disco_mb, swap_mb);
+    return 0;
+}
 
-    // Reservar área de swap
-    int swap_start_block = (DISK_SIZE - SWAP_SIZE) / BLOCK_SIZE;
-    int swap_blocks = SWAP_SIZE / BLOCK_SIZE;
-    for (int i = swap_start_block; i < swap_start_block + swap_blocks; i++)
+int allocate_swap_blocks(int blocks_needed)
+{
+    pthread_mutex_lock(&trava_metadados);
+    int inicio = alocador_reservar(alocador_swap, blocks_needed, politica_alocacao);
+    pthread_mutex_unlock(&trava_metadados);
+    estat_swap(blocks_needed, inicio == -1 ? -1 : 1);
+    return inicio;
+}
+
+void free_swap_blocks(int start_block, int num_blocks)
+{
+    pthread_mutex_lock(&trava_metadados);
+    alocador_liberar(alocador_swap, start_block, num_blocks);
+    pthread_mutex_unlock(&trava_metadados);
+    estat_swap(num_blocks, 0);
+    descartar_cache((off_t)start_block * BLOCK_SIZE, (off_t)num_blocks * BLOCK_SIZE); // Conteúdo descartável
+}
+
+// Escolhe a política de alocação contígua ("first" ou "best")
+int definir_politica_alocacao(const char *nome)
+{
+    if (strcmp(nome, "first") == 0)
+        politica_alocacao = 0;
+    else if (strcmp(nome, "best") == 0)
+        politica_alocacao = 1;
+    else
+    {
+        mostrar("Política '%s' desconhecida (use first ou best).\n", nome);
+        return -1;
+    }
+    mostrar("Política de alocação: %s-fit\n", nome);
+    return 0;
+}
+
+/* Geração em massa do conteúdo de um arquivo novo. O arquivo é dividido em pedaços
+   de NUMEROS_POR_PEDACO números; o pedaço p é o fluxo p do gerador, então o conteúdo
+   só depende da semente, não do número de threads. Cada thread pega pedaços por um
+   contador atômico e gera um enquanto o anterior é gravado (buffer duplo, escritas
+   grandes e alinhadas a blocos). */
+#define NUMEROS_POR_PEDACO (256 * 1024) // 1 MB
+
+uint64_t semente_geracao = 0;
+int semente_definida = 0; // Sem semente escolhida, cada arquivo usa uma nova (rand)
+
+// Distribuições dos números gerados (para medir a ordenação em entradas diferentes)
+#define DISTRIBUICAO_ALEATORIA 0
+#define DISTRIBUICAO_ORDENADA 1 // Crescente como int32, sem repetições
+#define DISTRIBUICAO_REVERSA 2  // Decrescente
+#define DISTRIBUICAO_REPETIDA 3 // Aleatória com só VALORES_REPETIDOS valores distintos
+#define VALORES_REPETIDOS 16
+
+const char *nomes_distribuicoes[] = {"aleatoria", "ordenada", "reversa", "repetida"};
+int distribuicao_geracao = DISTRIBUICAO_ALEATORIA;
+
+typedef struct
+{
+    const FileEntry *arquivo;
+    long total;      // Números no arquivo
+    long num_pedacos;
+    long proximo;    // Próximo pedaço livre
+    uint64_t semente;
+    int distribuicao;
+} CriacaoArquivo;
+
+int definir_distribuicao(const char *nome)
+{
+    for (int i = 0; i < (int)(sizeof(nomes_distribuicoes) / sizeof(nomes_distribuicoes[0])); i++)
+    {
+        if (strcmp(nome, nomes_distribuicoes[i]) == 0)
+        {
+            distribuicao_geracao = i;
+            mostrar("Distribuição dos números gerados: %s\n", nome);
+            return 0;
+        }
+    }
+    mostrar("Distribuição '%s' desconhecida (use aleatoria, ordenada, reversa ou repetida).\n", nome);
+    return -1;
+}
+
+// Preenche o pedaço que começa no número 'inicio' conforme a distribuição escolhida
+void gerar_distribuicao(const CriacaoArquivo *c, uint32_t *v, long n, long inicio, long pedaco)
+{
+    if (c->distribuicao == DISTRIBUICAO_ORDENADA || c->distribuicao == DISTRIBUICAO_REVERSA)
+    {
+        for (long i = 0; i < n; i++)
+        {
+            long pos = c->distribuicao == DISTRIBUICAO_ORDENADA ? inicio + i : c->total - 1 - (inicio + i);
+            v[i] = (uint32_t)(int32_t)(pos + INT32_MIN); // Crescente na ordem com sinal
+        }
+        return;
+    }
+    gerador_preencher(v, n, c->semente, pedaco);
+    if (c->distribuicao == DISTRIBUICAO_REPETIDA)
+        for (long i = 0; i < n; i++)
+            v[i] %= VALORES_REPETIDOS;
+}
+
+int definir_semente_geracao(unsigned long long semente)
+{
+    semente_geracao = semente;
+    semente_definida = 1;
+    mostrar("Semente do gerador: %llu\n", semente);
+    return 0;
+}
+
+void *gerar_pedacos(void *arg)
+{
+    CriacaoArquivo *c = arg;
+    // As duas metades vêm de uma área só, da reserva se houver (alinhada para O_DIRECT)
+    uint32_t *area = memoria_obter(2 * NUMEROS_POR_PEDACO * sizeof(uint32_t), BLOCK_SIZE);
+    uint32_t *buffers[2] = {area, area + NUMEROS_POR_PEDACO};
+    LoteES escritas[2] = {{{0}, 0}, {{0}, 0}};
+    if (!area)
+    {
+        perror("Erro ao alocar memória para geração");
+        return NULL;
+    }
+
+    int m = 0;
+    long p;
+    while ((p = __atomic_fetch_add(&c->proximo, 1, __ATOMIC_RELAXED)) < c->num_pedacos)
+    {
+        long inicio = p * NUMEROS_POR_PEDACO;
+        long n = c->total - inicio < NUMEROS_POR_PEDACO ? c->total - inicio : NUMEROS_POR_PEDACO;
+        lote_aguardar(&escritas[m]); // A metade precisa ter terminado de ser gravada
+        gerar_distribuicao(c, buffers[m], n, inicio, p);
+        lote_enviar(&escritas[m], c->arquivo, buffers[m], n * sizeof(uint32_t), inicio * sizeof(uint32_t), 1);
+        m = !m;
+    }
+    lote_aguardar(&escritas[0]);
+    lote_aguardar(&escritas[1]);
+    memoria_devolver(area);
+    return NULL;
+}
+
+/* Cria um arquivo com uma lista aleatória de números inteiros positivos de 32 bits.
+O argumento "tam" indica a quantidade de números. */
+int criar(const char *nome, long tam)
+{
+    if (tam < 0)
+    {
+        mostrar("Quantidade de números inválida: %ld.\n", tam);
+        return -1;
+    }
+
+    // Do slot reservado até ocupado, nenhum outro comando pode sondar o diretório
+    pthread_mutex_lock(&trava_metadados);
+    if (diretorio_precisa_crescer() && !comando_exclusivo())
+    {
+        pthread_mutex_unlock(&trava_metadados);
+        return REPETIR_EXCLUSIVO;
+    }
+    // Conta em blocos, antes de multiplicar: tam * sizeof(uint32_t) pode estourar
+    if (tam / ELEMENTOS_POR_BLOCO + (tam % ELEMENTOS_POR_BLOCO != 0) > alocador_livres(alocador_dados))
+    {
+        pthread_mutex_unlock(&trava_metadados);
+        mostrar("Espaço insuficiente no disco.\n");
+        return -1;
+    }
+    FileEntry *file = reservar_entrada(nome);
+    if (!file)
+    {
+        pthread_mutex_unlock(&trava_metadados);
+        return -1;
+    }
+
+    if (alocar_arquivo(file, tam * sizeof(uint32_t)) == -1)
+    {
+        pthread_mutex_unlock(&trava_metadados);
+        mostrar("Espaço insuficiente no disco.\n");
+        return -1;
+    }
+    file->size = tam * sizeof(uint32_t);
+    ocupar_entrada(file, nome);
+    pthread_mutex_unlock(&trava_metadados);
+
+    uint64_t semente = semente_definida ? semente_geracao : ((uint64_t)rand() << 32) ^ (uint64_t)rand();
+    CriacaoArquivo criacao = {file, tam, (tam + NUMEROS_POR_PEDACO - 1) / NUMEROS_POR_PEDACO, 0, semente,
+                              distribuicao_geracao};
+    int threads = criacao.num_pedacos < threads_ordenacao ? (int)criacao.num_pedacos : threads_ordenacao;
+    if (threads > 0)
+        executar_em_paralelo(gerar_pedacos, &criacao, 0, threads); // Todas compartilham 'criacao'
+    descartar_cache_arquivo(file);
+
+    sincronizar_metadados();
+    mostrar("Arquivo '%s' criado com sucesso.\n", nome);
+    return 0;
+}
+
+// Apaga um arquivo
+int apagar(const char *nome)
+{
+    FileEntry *file = buscar_arquivo(nome);
+    if (!file)
+    {
+        mostrar("Arquivo '%s' não encontrado.\n", nome);
+        return -1;
+    }
+
+    // Libera os blocos de todas as extensões (e do índice) e deixa o slot como lápide
+    descartar_indice(file);
+    liberar_arquivo(file);
+    remover_entrada(file);
+    sincronizar_metadados();
+    mostrar("Arquivo '%s' apagado com sucesso.\n", nome);
+    return 0;
+}
+
+/* Lista os arquivos
+Mostra, ao lado de cada arquivo, o seu tamanho em bytes.
+Também mostra o espaço total do "disco" e o espaço disponível. */
+int listar()
+{
+    long espaco_total = fs->sb.disk_size;
+    long espaco_usado = 0;
+
+    mostrar("Arquivos no diretório:\n");
+    pthread_mutex_lock(&trava_metadados);
+    for (uint32_t i = 0; i < fs->sb.capacidade_diretorio; i++)
+    {
+        if (diretorio[i].estado != ENTRADA_USADA)
+            continue;
+        mostrar("%s\t%ld bytes%s", diretorio[i].name, (long)diretorio[i].size,
+               diretorio[i].ordenado ? "\t(ordenado)" : "");
+        if (diretorio[i].formato == FORMATO_COMPACTADO)
+            mostrar("\t(compactado: %ld bytes no disco)", bytes_no_disco(&diretorio[i]));
+        mostrar("\n");
+        espaco_usado += bytes_no_disco(&diretorio[i]);
+    }
+    pthread_mutex_unlock(&trava_metadados);
+
+    long espaco_disponivel = espaco_total - espaco_usado;
+
+    mostrar("\nEspaço total do disco: %ld bytes (%.2f MB)\n", espaco_total, (double)espaco_total / (1024 * 1024));
+    mostrar("Espaço utilizado: %ld bytes (%.2f MB)\n", espaco_usado, (double)espaco_usado / (1024 * 1024));
+    mostrar("Espaço disponível: %ld bytes (%.2f MB)\n", espaco_disponivel, (double)espaco_disponivel / (1024 * 1024));
+    struct stat st;
+    if (fstat(disk_fd, &st) == 0)
+        mostrar("Espaço ocupado pela imagem no host: %.2f MB (arquivo esparso)\n",
+               (double)st.st_blocks * 512 / (1024 * 1024));
+    exibir_fragmentacao();
+    return 0;
+}
+
+// Função de comparação para int32_t (números com sinal)
+int comparar_int32(const void *a, const void *b)
+{
+    int32_t n1 = *(const int32_t *)a;
+    int32_t n2 = *(const int32_t *)b;
+    return (n1 > n2) - (n1 < n2);
+}
+
+// Algoritmos de ordenação em memória, escolhidos em tempo de execução
+#define ORDENACAO_QSORT 0
+#define ORDENACAO_RADIX 1
+#define ORDENACAO_PAGINADA 2 // Quicksort direto sobre a memória virtual paginada
+
+int algoritmo_ordenacao = ORDENACAO_RADIX;
+const char *nomes_algoritmos[] = {"qsort", "radix", "paginada"};
+int tamanho_pagina_virtual = 64 * 1024;
+
+/* Radix sort LSD com dígitos de 8 bits (4 passadas) para int32_t.
+   O bit de sinal é invertido na chave para que os negativos venham antes, mantendo
+   a mesma ordem de comparar_int32. Os quatro histogramas saem de uma única leitura e
+   as passadas em que todos os elementos têm o mesmo dígito são puladas.
+   'aux' precisa ter espaço para n elementos; o resultado fica sempre em 'v'. */
+void radix_sort_int32(int32_t *v, int n, int32_t *aux)
+{
+    uint32_t contagem[4][256];
+    memset(contagem, 0, sizeof(contagem));
+
+    for (int i = 0; i < n; i++)
+    {
+        uint32_t chave = (uint32_t)v[i] ^ 0x80000000u;
+        contagem[0][chave & 0xFF]++;
+        contagem[1][(chave >> 8) & 0xFF]++;
+        contagem[2][(chave >> 16) & 0xFF]++;
+        contagem[3][chave >> 24]++;
+    }
+
+    int32_t *origem = v, *destino = aux;
+    for (int d = 0; d < 4; d++)
+    {
+        int shift = d * 8;
+        uint32_t chave0 = ((uint32_t)v[0] ^ 0x80000000u) >> shift & 0xFF;
+        if (contagem[d][chave0] == (uint32_t)n)
+            continue; // Dígito igual em todos: passada desnecessária
+
+        uint32_t soma = 0;
+        for (int b = 0; b < 256; b++)
+        {
+            uint32_t c = contagem[d][b];
+            contagem[d][b] = soma;
+            soma += c;
+        }
+        for (int i = 0; i < n; i++)
+        {
+            uint32_t chave = (uint32_t)origem[i] ^ 0x80000000u;
+            destino[contagem[d][(chave >> shift) & 0xFF]++] = origem[i];
+        }
+
+        int32_t *t = origem;
+        origem = destino;
+        destino = t;
+    }
+    if (origem != v)
+        memcpy(v, origem, n * sizeof(int32_t));
+}
+
+// Quantos elementos o algoritmo atual ordena em 'espaco' elementos de memória
+int elementos_ordenaveis(int espaco)
+{
+    return algoritmo_ordenacao == ORDENACAO_RADIX ? espaco / 2 : espaco;
+}
+
+// Ordena v[0..n-1] com o algoritmo configurado; 'aux' é usado pelo radix sort
+void ordenar_memoria(int32_t *v, int n, int32_t *aux)
+{
+    if (n <= 1)
+        return;
+    if (algoritmo_ordenacao == ORDENACAO_RADIX)
+        radix_sort_int32(v, n, aux);
+    else
+        qsort(v, n, sizeof(int32_t), comparar_int32);
+}
+
+// Escolhe o algoritmo de ordenação em memória pelo nome ("qsort" ou "radix")
+int definir_algoritmo_ordenacao(const char *nome)
+{
+    for (int i = 0; i < (int)(sizeof(nomes_algoritmos) / sizeof(nomes_algoritmos[0])); i++)
+    {
+        if (strcmp(nomes_algoritmos[i], nome) == 0)
+        {
+            algoritmo_ordenacao = i;
+            mostrar("Algoritmo de ordenação: %s\n", nome);
+            return 0;
+        }
+    }
+    mostrar("Algoritmo '%s' desconhecido (use qsort, radix ou paginada).\n", nome);
+    return -1;
+}
+
+// Tamanho (em KB) das páginas da memória virtual usada pela ordenação paginada
+int definir_tamanho_pagina(int kb)
+{
+    // O limite vem antes da conta, para kb * 1024 não estourar
+    if (kb < BLOCK_SIZE / 1024 || kb > HUGE_PAGE_SIZE / 2048 || kb * 1024 % BLOCK_SIZE != 0)
+    {
+        mostrar("Tamanho de página inválido (múltiplo de %d KB, até %d KB).\n",
+               BLOCK_SIZE / 1024, HUGE_PAGE_SIZE / 2048);
+        return -1;
+    }
+    int bytes = kb * 1024;
+    tamanho_pagina_virtual = bytes;
+    mostrar("Páginas da memória virtual: %d KB (%d quadros na huge page).\n", kb, HUGE_PAGE_SIZE / bytes);
+    return 0;
+}
+
+void trocar_paginado(MemoriaVirtual *mv, long i, long j)
+{
+    int32_t t = mv_ler(mv, i);
+    mv_escrever(mv, i, mv_ler(mv, j));
+    mv_escrever(mv, j, t);
+}
+
+/* Quicksort sobre o vetor virtual: a partição de Hoare percorre a faixa pelas duas
+   pontas, o que dá boa localidade para o relógio da paginação. Quando uma faixa cabe
+   em uma única página, ela é fixada no quadro e ordenada ali mesmo com qsort.
+   A pilha explícita sempre guarda a metade maior, limitando a profundidade a log n.
+   Devolve -1 se uma página não pôde ser trazida ou gravada: aí mv_ler devolve 0, que
+   não serve de sentinela, então as varreduras da partição param no erro. */
+int ordenar_paginado(MemoriaVirtual *mv, long n)
+{
+    long epp = mv_elementos_por_pagina(mv);
+    long pilha[2 * 64];
+    int topo = 0;
+    pilha[topo++] = 0;
+    pilha[topo++] = n;
+
+    while (topo > 0)
+    {
+        long hi = pilha[--topo], lo = pilha[--topo];
+        while (hi - lo > 1)
+        {
+            if (lo / epp == (hi - 1) / epp)
+            {
+                int32_t *v = mv_fixar(mv, lo, hi - lo, 1);
+                if (!v)
+                {
+                    mv_soltar(mv, lo, hi - lo);
+                    return -1;
+                }
+                qsort(v, hi - lo, sizeof(int32_t), comparar_int32);
+                mv_soltar(mv, lo, hi - lo);
+                break;
+            }
+
+            // Mediana de três levada para 'lo' e usada como pivô
+            long meio = lo + (hi - lo) / 2;
+            int32_t a = mv_ler(mv, lo), b = mv_ler(mv, meio), c = mv_ler(mv, hi - 1);
+            long m = (a < b) ? ((b < c) ? meio : (a < c) ? hi - 1 : lo)
+                             : ((a < c) ? lo : (b < c) ? hi - 1 : meio);
+            if (m != lo)
+                trocar_paginado(mv, lo, m);
+            int32_t pivo = mv_ler(mv, lo);
+
+            long i = lo - 1, j = hi;
+            while (1)
+            {
+                do
+                    i++;
+                while (mv_ler(mv, i) < pivo && !mv_falhou(mv));
+                do
+                    j--;
+                while (mv_ler(mv, j) > pivo && !mv_falhou(mv));
+                if (mv_falhou(mv))
+                    return -1;
+                if (i >= j)
+                    break;
+                trocar_paginado(mv, i, j);
+            }
+
+            // [lo, j] e [j + 1, hi): empilha a maior e continua na menor
+            if (j + 1 - lo > hi - (j + 1))
+            {
+                pilha[topo++] = lo;
+                pilha[topo++] = j + 1;
+                lo = j + 1;
+            }
+            else
+            {
+                pilha[topo++] = j + 1;
+                pilha[topo++] = hi;
+                hi = j + 1;
+            }
+        }
+    }
+    return mv_falhou(mv) ? -1 : 0;
+}
+
+/* Formato compactado (opcional): em vez dos números, as extensões guardam a tabela
+   com a posição de cada bloco compactado (uint64, mais a do fim do último) seguida
+   dos blocos, um por bloco lógico de ELEMENTOS_POR_BLOCO números (compactacao.c).
+   'size' continua sendo o tamanho lógico, então ler um trecho custa a leitura da parte
+   da tabela e dos blocos que o cobrem. Os blocos de um arquivo ordenado guardam
+   diferenças e ficam bem menores. A saída é gerada em sequência, em um espaço novo
+   reservado para o pior caso e aparado no fim. Ordenar um arquivo fora de ordem e
+   concatenar reescrevem o conteúdo bruto: arquivos compactados são descompactados
+   antes. */
+#define BUFFER_COMPACTACAO (1024 * 1024) // Blocos compactados acumulados por escrita
+#define ELEMENTOS_CONVERSAO (256 * 1024)
+
+int compactar_saida = 0; // 1: a ordenação grava o resultado já compactado
+
+typedef struct
+{
+    FileEntry *destino; // Espaço novo que recebe o conteúdo compactado
+    uint64_t *posicoes; // Início de cada bloco no conteúdo (e o fim do último)
+    int num_blocos;
+    int bloco;          // Próximo bloco a compactar
+    int32_t pendentes[ELEMENTOS_POR_BLOCO]; // Números de um bloco ainda incompleto
+    int num_pendentes;
+    unsigned char *saida; // Blocos compactados ainda não gravados
+    size_t usados;
+    off_t offset;         // Posição no conteúdo do primeiro byte de 'saida'
+    int erro;
+} CompactadorSaida;
+
+int definir_compactacao_saida(int ativa)
+{
+    compactar_saida = ativa != 0;
+    mostrar("Ordenação grava o resultado %s.\n", compactar_saida ? "compactado" : "sem compactação");
+    return 0;
+}
+
+// Bytes da tabela de posições (os blocos começam alinhados a 8 bytes)
+long tamanho_tabela(int blocos)
+{
+    return (blocos + 1) * sizeof(uint64_t);
+}
+
+// Pior caso do conteúdo compactado de 'elementos' números
+long limite_compactado(long elementos)
+{
+    int blocos = (elementos + ELEMENTOS_POR_BLOCO - 1) / ELEMENTOS_POR_BLOCO;
+    return tamanho_tabela(blocos) + (long)blocos * limite_bloco_compactado(ELEMENTOS_POR_BLOCO);
+}
+
+// Encolhe as extensões de 'f' para guardarem só 'bytes' bytes e libera os blocos que sobram
+void aparar_arquivo(FileEntry *f, long bytes)
+{
+    int e = 0;
+    for (; e < f->num_extensoes && bytes > 0; e++)
+    {
+        Extensao *x = &f->extensoes[e];
+        if (x->bytes > bytes)
+        {
+            int blocos = blocos_extensao(x);
+            x->bytes = bytes;
+            liberar_blocos_dados(x->start_block + blocos_extensao(x), blocos - blocos_extensao(x));
+        }
+        bytes -= x->bytes;
+    }
+    for (int i = e; i < f->num_extensoes; i++)
+        liberar_blocos_dados(f->extensoes[i].start_block, blocos_extensao(&f->extensoes[i]));
+    f->num_extensoes = e;
+}
+
+/* O conteúdo de 'f' foi regravado em 'novo' ('bytes' bytes no 'formato'): as extensões
+   de 'novo' passam a ser as de 'f', e os blocos antigos são liberados. */
+void substituir_conteudo(FileEntry *f, FileEntry *novo, long bytes, int formato)
+{
+    aparar_arquivo(novo, bytes);
+    descartar_cache_arquivo(f);
+    liberar_arquivo(f);
+    f->num_extensoes = novo->num_extensoes;
+    memcpy(f->extensoes, novo->extensoes, novo->num_extensoes * sizeof(Extensao));
+    f->formato = formato;
+    marcar_metadados(f, sizeof(FileEntry));
+    sincronizar_metadados();
+}
+
+/* Prepara a compactação de 'elementos' números em um espaço novo, reservado em
+   'destino' para o pior caso; -1 (sem nada reservado) se não couber. */
+int compactador_iniciar(CompactadorSaida *c, FileEntry *destino, long elementos)
+{
+    if (alocar_arquivo(destino, limite_compactado(elementos)) == -1)
+        return -1;
+    c->destino = destino;
+    c->num_blocos = (elementos + ELEMENTOS_POR_BLOCO - 1) / ELEMENTOS_POR_BLOCO;
+    c->bloco = c->num_pendentes = c->erro = 0;
+    c->usados = 0;
+    c->offset = tamanho_tabela(c->num_blocos);
+    c->posicoes = malloc((c->num_blocos + 1) * sizeof(uint64_t));
+    c->saida = memoria_obter(BUFFER_COMPACTACAO + limite_bloco_compactado(ELEMENTOS_POR_BLOCO), BLOCK_SIZE);
+    if (!c->posicoes || !c->saida)
+    {
+        free(c->posicoes);
+        memoria_devolver(c->saida);
+        liberar_arquivo(destino);
+        return -1;
+    }
+    return 0;
+}
+
+void compactador_gravar(CompactadorSaida *c)
+{
+    if (c->usados > 0 && escrever_arquivo(c->destino, c->saida, c->usados, c->offset) != (ssize_t)c->usados)
+        c->erro = 1;
+    c->offset += c->usados;
+    c->usados = 0;
+}
+
+void compactador_bloco(CompactadorSaida *c, const int32_t *v, int n)
+{
+    c->posicoes[c->bloco++] = c->offset + c->usados;
+    c->usados += compactar_bloco(v, n, c->saida + c->usados);
+    if (c->usados >= BUFFER_COMPACTACAO)
+        compactador_gravar(c);
+}
+
+// Acrescenta v[0..n) ao conteúdo compactado; blocos inteiros vêm direto de 'v'
+void compactador_adicionar(CompactadorSaida *c, const int32_t *v, long n)
+{
+    while (n > 0)
+    {
+        if (c->num_pendentes == 0 && n >= ELEMENTOS_POR_BLOCO)
+        {
+            compactador_bloco(c, v, ELEMENTOS_POR_BLOCO);
+            v += ELEMENTOS_POR_BLOCO;
+            n -= ELEMENTOS_POR_BLOCO;
+            continue;
+        }
+        int k = ELEMENTOS_POR_BLOCO - c->num_pendentes < n ? ELEMENTOS_POR_BLOCO - c->num_pendentes : n;
+        memcpy(c->pendentes + c->num_pendentes, v, k * sizeof(int32_t));
+        c->num_pendentes += k;
+        v += k;
+        n -= k;
+        if (c->num_pendentes == ELEMENTOS_POR_BLOCO)
+        {
+            compactador_bloco(c, c->pendentes, c->num_pendentes);
+            c->num_pendentes = 0;
+        }
+    }
+}
+
+// Desiste da saída compactada: o espaço novo é liberado
+void compactador_descartar(CompactadorSaida *c)
+{
+    free(c->posicoes);
+    memoria_devolver(c->saida);
+    liberar_arquivo(c->destino);
+}
+
+/* Grava o que falta e a tabela. Deu certo: o espaço novo vira o conteúdo de 'f',
+   compactado. Senão ele é liberado e 'f' fica como estava. 0 ou -1. */
+int compactador_finalizar(CompactadorSaida *c, FileEntry *f)
+{
+    if (c->num_pendentes > 0)
+        compactador_bloco(c, c->pendentes, c->num_pendentes);
+    compactador_gravar(c);
+    c->posicoes[c->bloco] = c->offset;
+    size_t tabela = (c->num_blocos + 1) * sizeof(uint64_t);
+    if (escrever_arquivo(c->destino, c->posicoes, tabela, 0) != (ssize_t)tabela)
+        c->erro = 1;
+    if (c->erro)
+    {
+        perror("Erro ao gravar o arquivo compactado");
+        compactador_descartar(c);
+        return -1;
+    }
+    free(c->posicoes);
+    memoria_devolver(c->saida);
+    substituir_conteudo(f, c->destino, c->offset, FORMATO_COMPACTADO);
+    return 0;
+}
+
+/* Lê os números [pos, pos + n) de 'f', em qualquer formato; 0 ou -1. Do compactado,
+   lê só as posições dos blocos que cobrem o trecho e esses blocos, em grupos de até
+   BUFFER_COMPACTACAO bytes; os blocos inteiramente dentro do trecho são
+   descompactados direto em 'v'. */
+int ler_elementos(const FileEntry *f, int32_t *v, long pos, long n)
+{
+    if (n <= 0)
+        return 0;
+    if (f->formato == FORMATO_BRUTO)
+        return ler_arquivo((void *)f, v, n * sizeof(int32_t), pos * sizeof(int32_t)) == (ssize_t)(n * sizeof(int32_t))
+                   ? 0
+                   : -1;
+
+    int primeiro = pos / ELEMENTOS_POR_BLOCO;
+    int blocos = (pos + n - 1) / ELEMENTOS_POR_BLOCO - primeiro + 1;
+    size_t bytes_posicoes = (blocos + 1) * sizeof(uint64_t);
+    uint64_t *posicoes = malloc(bytes_posicoes);
+    unsigned char *dados = NULL;
+    int resultado = -1;
+    if (!posicoes ||
+        ler_arquivo((void *)f, posicoes, bytes_posicoes, primeiro * sizeof(uint64_t)) != (ssize_t)bytes_posicoes)
+        goto cleanup;
+    size_t total = posicoes[blocos] - posicoes[0];
+    dados = malloc(total < BUFFER_COMPACTACAO ? total
+                                              : BUFFER_COMPACTACAO + limite_bloco_compactado(ELEMENTOS_POR_BLOCO));
+    if (!dados)
+        goto cleanup;
+
+    int32_t numeros[ELEMENTOS_POR_BLOCO];
+    for (int b = 0; b < blocos;)
+    {
+        // Um grupo: pelo menos um bloco, e os seguintes enquanto couberem no buffer
+        int fim_grupo = b + 1;
+        while (fim_grupo < blocos && posicoes[fim_grupo + 1] - posicoes[b] <= BUFFER_COMPACTACAO)
+            fim_grupo++;
+        uint64_t inicio_grupo = posicoes[b];
+        size_t bytes = posicoes[fim_grupo] - inicio_grupo;
+        if (ler_arquivo((void *)f, dados, bytes, inicio_grupo) != (ssize_t)bytes)
+            goto cleanup;
+        for (; b < fim_grupo; b++)
+        {
+            long base = (long)(primeiro + b) * ELEMENTOS_POR_BLOCO;
+            const unsigned char *bloco = dados + (posicoes[b] - inicio_grupo);
+            if (base >= pos && base + ELEMENTOS_POR_BLOCO <= pos + n)
+            {
+                descompactar_bloco(bloco, v + (base - pos));
+                continue;
+            }
+            int validos = descompactar_bloco(bloco, numeros);
+            long de = pos > base ? pos - base : 0;
+            long ate = pos + n - base < validos ? pos + n - base : validos;
+            memcpy(v + (base + de - pos), numeros + de, (ate - de) * sizeof(int32_t));
+        }
+    }
+    resultado = 0;
+
+cleanup:
+    free(dados);
+    free(posicoes);
+    return resultado;
+}
+
+/* Regrava o conteúdo de 'f' no 'formato', em um espaço novo (as duas cópias precisam
+   caber no disco durante a conversão). A marca de ordenado e o índice continuam
+   valendo: os números são os mesmos. */
+int converter_formato(FileEntry *f, int formato)
+{
+    if (f->formato == formato)
+        return 0;
+
+    long elementos = f->size / sizeof(int32_t);
+    FileEntry novo;
+    CompactadorSaida c;
+    if (formato == FORMATO_COMPACTADO ? compactador_iniciar(&c, &novo, elementos) == -1
+                                      : alocar_arquivo(&novo, f->size) == -1)
+    {
+        mostrar("Espaço insuficiente para converter '%s'.\n", f->name);
+        return -1;
+    }
+
+    int32_t *buffer = memoria_obter(ELEMENTOS_CONVERSAO * sizeof(int32_t), BLOCK_SIZE);
+    int erro = !buffer;
+    for (long pos = 0; pos < elementos && !erro; pos += ELEMENTOS_CONVERSAO)
+    {
+        long n = elementos - pos < ELEMENTOS_CONVERSAO ? elementos - pos : ELEMENTOS_CONVERSAO;
+        if (ler_elementos(f, buffer, pos, n) == -1)
+            erro = 1;
+        else if (formato == FORMATO_COMPACTADO)
+            compactador_adicionar(&c, buffer, n);
+        else if (escrever_arquivo(&novo, buffer, n * sizeof(int32_t), pos * sizeof(int32_t)) !=
+                 (ssize_t)(n * sizeof(int32_t)))
+            erro = 1;
+    }
+    memoria_devolver(buffer);
+
+    if (formato == FORMATO_COMPACTADO)
+    {
+        c.erro |= erro;
+        return compactador_finalizar(&c, f);
+    }
+    if (erro)
+    {
+        perror("Erro ao converter o arquivo");
+        liberar_arquivo(&novo);
+        return -1;
+    }
+    substituir_conteudo(f, &novo, f->size, FORMATO_BRUTO);
+    return 0;
+}
+
+// Comandos compactar e descompactar: mudam o formato de um arquivo existente
+int definir_formato(const char *nome, int formato)
+{
+    FileEntry *file = buscar_arquivo(nome);
+    if (!file)
+    {
+        mostrar("Arquivo '%s' não encontrado.\n", nome);
+        return -1;
+    }
+    if (converter_formato(file, formato) == -1)
+        return -1;
+    long guardados = bytes_no_disco(file);
+    mostrar("Arquivo '%s' %s: %ld bytes de números em %ld bytes no disco (%.1f%%).\n", nome,
+           formato == FORMATO_COMPACTADO ? "compactado" : "descompactado", (long)file->size, guardados,
+           file->size ? 100.0 * guardados / file->size : 100.0);
+    return 0;
+}
+
+/* A intercalação trabalha em janelas de tamanho fixo recortadas da huge page, sempre
+   em blocos inteiros: cada recarga e cada descarga é uma transferência alinhada a
+   BLOCK_SIZE, e a memória usada não depende do tamanho do arquivo. Cada via tem duas
+   metades (buffer duplo): enquanto uma é consumida, a outra é lida em segundo plano.
+   O k máximo sai do orçamento: duas janelas mínimas (1 bloco cada) por via mais as
+   duas da saída. */
+#define JANELA_MINIMA (BLOCK_SIZE / sizeof(int32_t))
+
+// Cursor de leitura de uma run durante a intercalação k-way
+typedef struct
+{
+    int32_t *janelas[2]; // Buffer duplo dentro da huge page
+    int atual;           // Metade sendo consumida
+    int capacidade;      // Capacidade de cada metade em elementos
+    int pos;             // Próximo elemento a consumir na metade atual
+    int validos;         // Elementos válidos na metade atual
+    LoteES leitura;      // Leitura antecipada da outra metade (vazia se nenhuma)
+    int a_chegar;        // Elementos que a leitura antecipada vai trazer
+    off_t offset;        // Próxima posição a ler no disco (ou no arquivo de origem)
+    long restantes;      // Elementos da run ainda não pedidos ao disco
+    const FileEntry *origem; // Arquivo das runs naturais; NULL para runs na swap
+    int decrescente;         // Lê para trás e inverte cada janela
+    int erro;                // Uma leitura da run falhou
+} CursorRun;
+
+// Janela de saída da intercalação: enche uma metade enquanto a outra é gravada
+typedef struct
+{
+    int32_t *janelas[2];
+    int atual;
+    int capacidade;
+    int usados;
+    LoteES lotes[2];          // Escritas pendentes de cada metade
+    const FileEntry *arquivo; // Destino: arquivo (posições lógicas) ou NULL (disco)
+    off_t offset;             // Próxima posição a escrever
+    int32_t *indice;          // Índice esparso a preencher com a saída (ou NULL)
+    CompactadorSaida *compactador; // Com ele, a saída vai compactada para o espaço dele
+    int erro;                      // Uma gravação falhou
+} JanelaSaida;
+
+// Pede ao disco a próxima fatia da run para a metade que não está em uso
+void antecipar_cursor(CursorRun *c)
+{
+    c->leitura.n = 0;
+    c->a_chegar = c->restantes < c->capacidade ? c->restantes : c->capacidade;
+    if (c->a_chegar == 0)
+        return;
+    size_t bytes = c->a_chegar * sizeof(int32_t);
+    if (c->decrescente)
+        c->offset -= bytes;
+    if (c->origem && c->origem->formato == FORMATO_COMPACTADO)
+    {
+        // Já descompactada
+        if (ler_elementos(c->origem, c->janelas[!c->atual], c->offset / sizeof(int32_t), c->a_chegar) == -1)
+            c->erro = 1;
+    }
+    else if (c->origem)
+        lote_enviar(&c->leitura, c->origem, c->janelas[!c->atual], bytes, c->offset, 0);
+    else
+    {
+        c->leitura.tickets[0] = es_swap(c->janelas[!c->atual], bytes, c->offset, 0);
+        c->leitura.n = 1;
+    }
+    if (!c->decrescente)
+        c->offset += bytes;
+    c->restantes -= c->a_chegar;
+}
+
+void inverter_int32(int32_t *v, int n)
+{
+    for (int i = 0, j = n - 1; i < j; i++, j--)
+    {
+        int32_t t = v[i];
+        v[i] = v[j];
+        v[j] = t;
+    }
+}
+
+// Troca para a metade antecipada e já pede a seguinte
+void recarregar_cursor(CursorRun *c)
+{
+    if (c->a_chegar == 0)
+    {
+        c->validos = c->pos = 0;
+        return;
+    }
+    if (lote_aguardar(&c->leitura) == -1)
+        c->erro = 1;
+    c->atual = !c->atual;
+    c->pos = 0;
+    c->validos = c->a_chegar;
+    if (c->decrescente)
+        inverter_int32(c->janelas[c->atual], c->validos);
+    antecipar_cursor(c);
+}
+
+void descarregar_saida(JanelaSaida *s)
+{
+    if (s->usados == 0)
+        return;
+    if (s->indice)
+    {
+        // Primeira chave de cada bloco lógico que começa nesta janela
+        long primeiro = s->offset / sizeof(int32_t);
+        for (long e = (primeiro + ELEMENTOS_POR_BLOCO - 1) / ELEMENTOS_POR_BLOCO * ELEMENTOS_POR_BLOCO;
+             e < primeiro + s->usados; e += ELEMENTOS_POR_BLOCO)
+            s->indice[e / ELEMENTOS_POR_BLOCO] = s->janelas[s->atual][e - primeiro];
+    }
+    if (s->compactador)
+    {
+        // A compactação grava em sequência e sem esperar: a mesma metade é reusada
+        compactador_adicionar(s->compactador, s->janelas[s->atual], s->usados);
+        s->offset += s->usados * sizeof(int32_t);
+        s->usados = 0;
+        return;
+    }
+    lote_enviar(&s->lotes[s->atual], s->arquivo, s->janelas[s->atual], s->usados * sizeof(int32_t), s->offset, 1);
+    s->offset += s->usados * sizeof(int32_t);
+    s->usados = 0;
+    s->atual = !s->atual;
+
+    // A metade que volta a ser preenchida precisa ter terminado de ser gravada
+    if (lote_aguardar(&s->lotes[s->atual]) == -1)
+        s->erro = 1;
+}
+
+// Grava o que falta e espera as gravações; -1 se alguma falhou
+int finalizar_saida(JanelaSaida *s)
+{
+    descarregar_saida(s);
+    if (lote_aguardar(&s->lotes[0]) == -1 || lote_aguardar(&s->lotes[1]) == -1)
+        s->erro = 1;
+    return s->erro ? -1 : 0;
+}
+
+// Maior k que cabe em 'capacidade' elementos de memória
+int max_vias(int capacidade)
+{
+    return capacidade / (2 * JANELA_MINIMA) - 1;
+}
+
+// Tamanho de cada metade de janela (em elementos) das k+1 vias, múltiplo de um bloco
+int janela_por_via(int k, int capacidade)
+{
+    return (capacidade / (2 * (k + 1))) / JANELA_MINIMA * JANELA_MINIMA;
+}
+
+// Verdadeiro se a run 'a' vence 'b' (menor valor); runs esgotadas valem +infinito
+int vence(const CursorRun *cursores, int a, int b)
+{
+    const CursorRun *ca = &cursores[a], *cb = &cursores[b];
+    if (ca->pos >= ca->validos)
+        return 0;
+    if (cb->pos >= cb->validos)
+        return 1;
+    int32_t va = ca->janelas[ca->atual][ca->pos], vb = cb->janelas[cb->atual][cb->pos];
+    return va < vb || (va == vb && a < b);
+}
+
+/* Monta a árvore de perdedores das k vias: folhas em k..2k-1, nós internos em 1..k-1
+   com a perdedora de cada confronto, e a vencedora em arvore[0] */
+void montar_arvore(const CursorRun *cursores, int k, int *arvore)
+{
+    int *vencedores = malloc(2 * k * sizeof(int));
+    for (int i = 0; i < k; i++)
+        vencedores[k + i] = i;
+    for (int n = k - 1; n >= 1; n--)
+    {
+        int a = vencedores[2 * n], b = vencedores[2 * n + 1];
+        if (vence(cursores, a, b))
+        {
+            vencedores[n] = a;
+            arvore[n] = b;
+        }
+        else
+        {
+            vencedores[n] = b;
+            arvore[n] = a;
+        }
+    }
+    arvore[0] = (k > 1) ? vencedores[1] : 0;
+    free(vencedores);
+}
+
+// A via 'w' avançou: refaz os confrontos do caminho da folha dela até a raiz
+void refazer_caminho(const CursorRun *cursores, int k, int *arvore, int w)
+{
+    for (int n = (w + k) / 2; n >= 1; n /= 2)
+    {
+        if (vence(cursores, arvore[n], w))
+        {
+            int t = arvore[n];
+            arvore[n] = w;
+            w = t;
+        }
+    }
+    arvore[0] = w;
+}
+
+void gravar_na_saida(JanelaSaida *s, int32_t valor)
+{
+    s->janelas[s->atual][s->usados++] = valor;
+    if (s->usados == s->capacidade)
+        descarregar_saida(s);
+}
+
+/* Intercala as runs[0..k-1] em uma única sequência gravada a partir do byte 'destino'
+   do disco ou, com 'arquivo', da posição 'destino' dentro do arquivo. As runs estão na
+   swap ou, com 'origem', são trechos (runs naturais) do arquivo 'origem'. Com
+   'indice', a primeira chave de cada bloco lógico gravado é anotada nele. Com
+   'compactador', a saída vai compactada para ele em vez de para 'destino'.
+   Usa uma árvore de perdedores: arvore[0] guarda a run vencedora e os nós internos
+   1..k-1 guardam as perdedoras de cada confronto, então cada elemento custa log2(k)
+   comparações. Os 'capacidade' elementos de 'buffer' são divididos em k janelas de
+   entrada e uma de saída, todas do mesmo tamanho fixo; nenhuma run é carregada
+   inteira. As leituras das próximas fatias e a gravação da saída correm em paralelo
+   com as comparações. Devolve 0, ou -1 se uma leitura ou gravação falhou. */
+int intercalar_runs(RunInfo *runs, int k, const FileEntry *origem, off_t destino, const FileEntry *arquivo,
+                     int32_t *indice, CompactadorSaida *compactador, int32_t *buffer, int capacidade)
+{
+    long inicio = estat_agora();
+    long total = 0;
+    for (int i = 0; i < k; i++)
+        total += runs[i].num_elements;
+
+    int janela = janela_por_via(k, capacidade);
+    CursorRun *cursores = malloc(k * sizeof(CursorRun));
+    int *arvore = malloc(k * sizeof(int));
+    if (!cursores || !arvore)
+    {
+        perror("Erro ao alocar memória para a intercalação");
+        free(cursores);
+        free(arvore);
+        return -1;
+    }
+    int32_t *base_saida = buffer + (size_t)2 * k * janela;
+    JanelaSaida saida = {{base_saida, base_saida + janela}, 0, janela, 0, {{{0}, 0}, {{0}, 0}}, arquivo, destino,
+                         indice, compactador, 0};
+
+    for (int i = 0; i < k; i++)
+    {
+        int32_t *base = buffer + (size_t)2 * i * janela;
+        long primeiro = runs[i].primeiro + (runs[i].decrescente ? runs[i].num_elements : 0);
+        cursores[i] = (CursorRun){{base, base + janela}, 1, janela, 0, 0, {{0}, 0}, 0,
+                                  (off_t)runs[i].start_block * BLOCK_SIZE + (off_t)primeiro * sizeof(int32_t),
+                                  runs[i].num_elements, origem, runs[i].decrescente, 0};
+        antecipar_cursor(&cursores[i]);
+    }
+    int erro = 0; // Uma leitura falhou: para sem gravar o resto
+    for (int i = 0; i < k; i++)
+    {
+        recarregar_cursor(&cursores[i]);
+        erro |= cursores[i].erro;
+    }
+    montar_arvore(cursores, k, arvore);
+
+    while (!erro)
+    {
+        int w = arvore[0];
+        CursorRun *c = &cursores[w];
+        if (c->pos >= c->validos)
+            break; // A vencedora esgotou: todas esgotaram
+
+        gravar_na_saida(&saida, c->janelas[c->atual][c->pos++]);
+        if (c->pos >= c->validos)
+        {
+            recarregar_cursor(c);
+            erro = c->erro;
+        }
+        refazer_caminho(cursores, k, arvore, w);
+    }
+    if (finalizar_saida(&saida) == -1)
+        erro = 1;
+    for (int i = 0; i < k; i++)
+        lote_aguardar(&cursores[i].leitura); // Parando antes do fim, há leituras a caminho
+
+    free(arvore);
+    free(cursores);
+    estat_intercalacao(total, estat_agora() - inicio);
+    return erro ? -1 : 0;
+}
+
+// Configuração da ordenação paralela
+#define MAX_THREADS_ORDENACAO 64
+#define AMOSTRAS_POR_RUN 64
+
+int threads_ordenacao = 1;
+int orcamento_por_thread = 0; // 0: uma huge page dividida entre as threads; 1: uma por thread
+
+/* Define quantas threads a ordenação externa usa. Com orçamento fixo, a memória da
+   reserva é repartida entre elas (menos vias por thread na intercalação); com
+   orçamento por thread, cada uma recebe sua própria huge page da reserva. */
+int definir_threads_ordenacao(int threads, int por_thread)
+{
+    if (threads < 1 || threads > MAX_THREADS_ORDENACAO)
+    {
+        mostrar("Número de threads inválido (1 a %d).\n", MAX_THREADS_ORDENACAO);
+        return -1;
+    }
+    threads_ordenacao = threads;
+    orcamento_por_thread = por_thread;
+    mostrar("Ordenação com %d thread(s), orçamento %s.\n", threads,
+           por_thread ? "de uma huge page por thread" : "fixo (a reserva de memória repartida)");
+    return 0;
+}
+
+// Estado compartilhado da geração de runs: as threads pegam fatias pelo contador
+typedef struct
+{
+    const FileEntry *arquivo; // Arquivo a ordenar
+    int fatia;     // Elementos por run
+    int num_runs;
+    RunInfo *runs; // Blocos de swap já reservados para cada run
+    int proxima;   // Próxima fatia livre
+    int erro;      // Uma leitura do arquivo falhou
+} GeracaoRuns;
+
+typedef struct
+{
+    GeracaoRuns *g;
+    int32_t *regiao; // Parte da memória de ordenação desta thread
+} TarefaGeracao;
+
+typedef struct
+{
+    RunInfo *segmentos;
+    int k;
+    off_t destino; // Posição no arquivo
+    const FileEntry *arquivo;
+    int32_t *indice;
+    int32_t *regiao;
+    int capacidade;
+    int resultado; // O de intercalar_runs
+} TarefaIntercalacao;
+
+int pegar_fatia(GeracaoRuns *g)
+{
+    return __atomic_fetch_add(&g->proxima, 1, __ATOMIC_RELAXED);
+}
+
+/* Lê a fatia 'i' do arquivo em 'v': do bruto, em segundo plano (pelo lote 'l'); do
+   compactado, na hora e já descompactada. -1 se a leitura imediata falhou. */
+int ler_fatia(GeracaoRuns *g, LoteES *l, int32_t *v, int i)
+{
+    long pos = (long)i * g->fatia;
+    if (g->arquivo->formato != FORMATO_BRUTO)
+        return ler_elementos(g->arquivo, v, pos, g->runs[i].num_elements);
+    lote_enviar(l, g->arquivo, v, g->runs[i].num_elements * sizeof(int32_t), pos * sizeof(int32_t), 0);
+    return 0;
+}
+
+/* Geração de runs com buffer duplo: enquanto uma metade da região é ordenada, a
+   fatia seguinte é lida na outra metade e a run anterior é gravada na swap. O radix
+   sort usa uma terceira área do mesmo tamanho como auxiliar. */
+void *gerar_runs(void *arg)
+{
+    TarefaGeracao *t = arg;
+    GeracaoRuns *g = t->g;
+    int32_t *metades[2] = {t->regiao, t->regiao + g->fatia};
+    int32_t *auxiliar = t->regiao + 2 * g->fatia;
+    LoteES leituras[2] = {{{0}, 0}, {{0}, 0}};
+    int escritas[2] = {-1, -1};
+    int m = 0, erro = 0;
+
+    int atual = pegar_fatia(g);
+    if (atual < g->num_runs)
+        erro |= ler_fatia(g, &leituras[0], metades[0], atual) == -1;
+    while (atual < g->num_runs)
+    {
+        erro |= lote_aguardar(&leituras[m]) == -1;
+
+        int proxima = pegar_fatia(g);
+        if (proxima < g->num_runs)
+        {
+            erro |= es_aguardar(escritas[!m]) < 0;
+            escritas[!m] = -1;
+            erro |= ler_fatia(g, &leituras[!m], metades[!m], proxima) == -1;
+        }
+
+        RunInfo *r = &g->runs[atual];
+        ordenar_memoria(metades[m], r->num_elements, auxiliar);
+        escritas[m] = es_swap(metades[m], r->num_elements * sizeof(int32_t), (off_t)r->start_block * BLOCK_SIZE, 1);
+        atual = proxima;
+        m = !m;
+    }
+    erro |= es_aguardar(escritas[0]) < 0;
+    erro |= es_aguardar(escritas[1]) < 0;
+    if (erro)
+        __atomic_store_n(&g->erro, 1, __ATOMIC_RELAXED);
+    return NULL;
+}
+
+void *intercalar_particao(void *arg)
+{
+    TarefaIntercalacao *t = arg;
+    t->resultado =
+        intercalar_runs(t->segmentos, t->k, NULL, t->destino, t->arquivo, t->indice, NULL, t->regiao, t->capacidade);
+    return NULL;
+}
+
+void liberar_swap_runs(const RunInfo *runs, int num_runs)
+{
+    for (int i = 0; i < num_runs; i++)
+        free_swap_blocks(runs[i].start_block, runs[i].num_blocks);
+}
+
+// Reserva a swap das runs de 'total' elementos em fatias de 'fatia'; NULL sem espaço
+RunInfo *reservar_runs(long total, int fatia, int num_runs)
+{
+    RunInfo *runs = malloc((num_runs > 0 ? num_runs : 1) * sizeof(RunInfo));
+    if (!runs)
+    {
+        perror("Erro ao alocar memória para as runs");
+        return NULL;
+    }
+    for (int i = 0; i < num_runs; i++)
+    {
+        int elementos = (i == num_runs - 1) ? (int)(total - (long)i * fatia) : fatia;
+        int blocos = (elementos * sizeof(int32_t) + BLOCK_SIZE - 1) / BLOCK_SIZE;
+        int bloco_inicial = allocate_swap_blocks(blocos);
+        if (bloco_inicial == -1)
+        {
+            mostrar("Espaço insuficiente na área de swap para a ordenação.\n");
+            liberar_swap_runs(runs, i);
+            free(runs);
+            return NULL;
+        }
+        runs[i] = (RunInfo){bloco_inicial, blocos, elementos, 0, 0};
+    }
+    return runs;
+}
+
+/* Passadas intermediárias: intercala grupos de runs (até max_vias('capacidade') em
+   cada) até sobrarem no máximo 'alvo'. Sem swap para uma passada ou com erro de E/S,
+   libera todas as runs, deixa '*runs' NULL e devolve -1. */
+int reduzir_runs(RunInfo **runs, int *num_runs, int alvo, int32_t *buffer, int capacidade)
+{
+    while (*num_runs > alvo)
+    {
+        // Grupos grandes o bastante para sobrarem no máximo 'alvo' runs
+        int vias = (*num_runs + alvo - 1) / alvo;
+        if (vias < 2)
+            vias = 2;
+        if (vias > max_vias(capacidade))
+            vias = max_vias(capacidade);
+        int new_runs = (*num_runs + vias - 1) / vias;
+        RunInfo *new_runs_arr = malloc(new_runs * sizeof(RunInfo));
+        estat_passada();
+
+        for (int g = 0; g < new_runs; g++)
+        {
+            RunInfo *grupo = &(*runs)[g * vias];
+            int k = (g == new_runs - 1) ? *num_runs - g * vias : vias;
+            RunInfo merged = {-1, 0, 0, 0, 0};
+            for (int i = 0; i < k; i++)
+                merged.num_elements += grupo[i].num_elements;
+            merged.num_blocks = (int)((merged.num_elements * sizeof(int32_t) + BLOCK_SIZE - 1) / BLOCK_SIZE);
+            merged.start_block = allocate_swap_blocks(merged.num_blocks);
+            if (merged.start_block == -1 ||
+                intercalar_runs(grupo, k, NULL, (off_t)merged.start_block * BLOCK_SIZE, NULL, NULL, NULL, buffer,
+                                capacidade) == -1)
+            {
+                if (merged.start_block == -1)
+                    mostrar("Espaço insuficiente na área de swap para a ordenação.\n");
+                else
+                {
+                    mostrar("Erro de E/S em uma passada intermediária da ordenação.\n");
+                    free_swap_blocks(merged.start_block, merged.num_blocks);
+                }
+                liberar_swap_runs(new_runs_arr, g);
+                liberar_swap_runs(grupo, *num_runs - g * vias);
+                free(new_runs_arr);
+                free(*runs);
+                *runs = NULL;
+                return -1;
+            }
+            liberar_swap_runs(grupo, k);
+            new_runs_arr[g] = merged;
+        }
+
+        free(*runs);
+        *runs = new_runs_arr;
+        *num_runs = new_runs;
+    }
+    return 0;
+}
+
+/* Ordena 'f' sem mexer nele: as fatias vão ordenadas para runs na swap, como na
+   geração de runs de ordenar, com uma thread e os 'capacidade' elementos de 'buffer'.
+   Devolve as runs (quantas em '*num_runs') ou NULL. */
+RunInfo *ordenar_em_runs(const FileEntry *f, int32_t *buffer, int capacidade, int *num_runs)
+{
+    long total = f->size / sizeof(int32_t);
+    int areas = algoritmo_ordenacao == ORDENACAO_RADIX ? 3 : 2;
+    int fatia = capacidade / areas / JANELA_MINIMA * JANELA_MINIMA;
+    *num_runs = (int)((total + fatia - 1) / fatia);
+    RunInfo *runs = reservar_runs(total, fatia, *num_runs);
+    if (!runs)
+        return NULL;
+
+    GeracaoRuns geracao = {f, fatia, *num_runs, runs, 0, 0};
+    TarefaGeracao tarefa = {&geracao, buffer};
+    gerar_runs(&tarefa);
+    estat_runs(*num_runs);
+    if (geracao.erro)
+    {
+        mostrar("Erro ao ler o arquivo '%s'.\n", f->name);
+        liberar_swap_runs(runs, *num_runs);
+        free(runs);
+        return NULL;
+    }
+    return runs;
+}
+
+// Uma thread de executar_em_paralelo: conta nas estatísticas da operação de quem a criou
+typedef struct
+{
+    void *(*funcao)(void *);
+    void *arg;
+    void *operacao;
+} TarefaParalela;
+
+void *rodar_tarefa(void *arg)
+{
+    TarefaParalela *t = arg;
+    estat_adotar_operacao(t->operacao);
+    return t->funcao(t->arg);
+}
+
+// Roda 'funcao' em 'n' threads, cada uma com seu argumento, e espera todas
+void executar_em_paralelo(void *(*funcao)(void *), void *args, size_t tam_arg, int n)
+{
+    pthread_t threads[MAX_THREADS_ORDENACAO];
+    TarefaParalela tarefas[MAX_THREADS_ORDENACAO];
+    int criadas = 0;
+    for (int i = 1; i < n; i++)
+    {
+        tarefas[criadas] = (TarefaParalela){funcao, (char *)args + i * tam_arg, estat_operacao_corrente()};
+        if (pthread_create(&threads[criadas], NULL, rodar_tarefa, &tarefas[criadas]) != 0)
+        {
+            funcao((char *)args + i * tam_arg); // Sem thread: roda nesta mesma
+            continue;
+        }
+        criadas++;
+    }
+    funcao(args);
+    for (int i = 0; i < criadas; i++)
+        pthread_join(threads[i], NULL);
+}
+
+// Lê em '*v' o elemento 'pos' da run, direto do disco; 0 ou -1
+int ler_elemento(const RunInfo *r, long pos, int32_t *v)
+{
+    long inicio = estat_agora();
+    ssize_t lidos = pread(disk_fd, v, sizeof(*v), (off_t)r->start_block * BLOCK_SIZE + (off_t)pos * sizeof(int32_t));
+    estat_es(0, lidos > 0 ? lidos : 0, estat_agora() - inicio);
+    return lidos == (ssize_t)sizeof(*v) ? 0 : -1;
+}
+
+// Primeira posição da run com valor >= chave (busca binária direto no disco), ou -1 se uma leitura falhar
+long limite_inferior(const RunInfo *r, int32_t chave)
+{
+    long lo = 0, hi = r->num_elements;
+    while (lo < hi)
+    {
+        long meio = lo + (hi - lo) / 2;
+        int32_t v;
+        if (ler_elemento(r, meio, &v) == -1)
+            return -1;
+        if (v < chave)
+            lo = meio + 1;
+        else
+            hi = meio;
+    }
+    return lo;
+}
+
+/* Intercalação paralela por faixas de chaves. Separadores são amostrados das runs e
+   cada run é cortada (busca binária) nas posições dos separadores; a thread j
+   intercala os segmentos da faixa j e grava no trecho da saída que começa na soma
+   das posições de corte, então as threads escrevem em intervalos disjuntos. Devolve
+   0, ou -1 se a amostragem, um corte ou alguma faixa falhou. */
+int intercalar_em_paralelo(RunInfo *runs, int k, const FileEntry *arquivo, int32_t *indice, int32_t **regioes,
+                            int capacidade, int partes)
+{
+    int total_amostras = k * AMOSTRAS_POR_RUN;
+    int32_t *amostras = malloc(total_amostras * sizeof(int32_t));
+    long *cortes = malloc((partes + 1) * k * sizeof(long));
+    RunInfo *segmentos = malloc(partes * k * sizeof(RunInfo));
+    TarefaIntercalacao *tarefas = malloc(partes * sizeof(TarefaIntercalacao));
+    int resultado = 0;
+    if (!amostras || !cortes || !segmentos || !tarefas)
+    {
+        perror("Erro ao alocar memória para a intercalação paralela");
+        resultado = -1;
+        goto cleanup;
+    }
+
+    for (int i = 0; i < k; i++)
+        for (int s = 0; s < AMOSTRAS_POR_RUN; s++)
+            if (ler_elemento(&runs[i], ((long)s * 2 + 1) * runs[i].num_elements / (2 * AMOSTRAS_POR_RUN),
+                             &amostras[i * AMOSTRAS_POR_RUN + s]) == -1)
+            {
+                resultado = -1;
+                goto cleanup;
+            }
+    qsort(amostras, total_amostras, sizeof(int32_t), comparar_int32);
+
+    // cortes[j * k + i]: início da faixa j na run i (faixa 'partes' = fim da run)
+    for (int i = 0; i < k; i++)
+    {
+        cortes[i] = 0;
+        cortes[partes * k + i] = runs[i].num_elements;
+        for (int j = 1; j < partes; j++)
+        {
+            cortes[j * k + i] = limite_inferior(&runs[i], amostras[(long)j * total_amostras / partes]);
+            if (cortes[j * k + i] == -1)
+            {
+                resultado = -1;
+                goto cleanup;
+            }
+        }
+    }
+
+    off_t saida = 0;
+    for (int j = 0; j < partes; j++)
+    {
+        for (int i = 0; i < k; i++)
+        {
+            RunInfo *s = &segmentos[j * k + i];
+            *s = runs[i];
+            s->primeiro = cortes[j * k + i];
+            s->num_elements = cortes[(j + 1) * k + i] - cortes[j * k + i];
+        }
+        tarefas[j] = (TarefaIntercalacao){&segmentos[j * k], k, saida, arquivo, indice, regioes[j], capacidade, 0};
+        for (int i = 0; i < k; i++)
+            saida += (off_t)segmentos[j * k + i].num_elements * sizeof(int32_t);
+    }
+
+    executar_em_paralelo(intercalar_particao, tarefas, sizeof(TarefaIntercalacao), partes);
+    for (int j = 0; j < partes; j++)
+        if (tarefas[j].resultado == -1)
+            resultado = -1;
+
+cleanup:
+    free(tarefas);
+    free(segmentos);
+    free(cortes);
+    free(amostras);
+    return resultado;
+}
+
+/* Pré-passada da ordenação adaptativa: lê o arquivo uma vez, em sequência, e acha as
+   runs naturais (trechos crescentes ou estritamente decrescentes, como no Timsort).
+   Preenche runs[] com posições lógicas do arquivo e devolve quantas são, ou -1 assim
+   que passarem de 'max': a entrada não tem ordem aproveitável e a leitura para cedo.
+   Devolve -2 se uma leitura falhou. Anota em 'indice' a primeira chave de cada bloco
+   (o índice, se já estava ordenado). */
+int detectar_runs_naturais(const FileEntry *f, int32_t *buffer, int capacidade, RunInfo *runs, int max,
+                           int32_t *indice)
+{
+    long total = f->size / sizeof(int32_t);
+    int metade = capacidade / 2 / JANELA_MINIMA * JANELA_MINIMA;
+    int32_t *janelas[2] = {buffer, buffer + metade};
+    LoteES leituras[2] = {{{0}, 0}, {{0}, 0}};
+    int n = 0, direcao = 0; // 1: crescente, -1: decrescente, 0: ainda não se sabe
+    long inicio = 0;
+    int32_t anterior = 0;
+
+    if (total > 0)
+        lote_enviar(&leituras[0], f, janelas[0], (total < metade ? total : metade) * sizeof(int32_t), 0, 0);
+    long base = 0;
+    for (int m = 0; base < total; base += metade, m = !m)
+    {
+        int validos = total - base < metade ? total - base : metade;
+        if (lote_aguardar(&leituras[m]) == -1)
+        {
+            lote_aguardar(&leituras[!m]);
+            return -2;
+        }
+        if (base + metade < total)
+        {
+            int seguintes = total - base - metade < metade ? total - base - metade : metade;
+            lote_enviar(&leituras[!m], f, janelas[!m], seguintes * sizeof(int32_t),
+                        (off_t)(base + metade) * sizeof(int32_t), 0);
+        }
+
+        for (int i = 0; i < validos; i++)
+        {
+            int32_t x = janelas[m][i];
+            long pos = base + i;
+            if (pos % ELEMENTOS_POR_BLOCO == 0)
+                indice[pos / ELEMENTOS_POR_BLOCO] = x;
+            if (pos > inicio)
+            {
+                if (direcao == 0)
+                    direcao = x >= anterior ? 1 : -1;
+                else if ((direcao == 1) != (x >= anterior))
+                {
+                    if (n == max)
+                    {
+                        lote_aguardar(&leituras[!m]);
+                        return -1;
+                    }
+                    runs[n++] = (RunInfo){0, 0, pos - inicio, inicio, direcao == -1};
+                    inicio = pos;
+                    direcao = 0;
+                }
+            }
+            anterior = x;
+        }
+    }
+    if (total > 0)
+    {
+        if (n == max)
+            return -1;
+        runs[n++] = (RunInfo){0, 0, total - inicio, inicio, direcao == -1};
+    }
+    return n;
+}
+
+// Verdadeiro se v[0..n) já está em ordem crescente
+int ja_ordenado(const int32_t *v, int n)
+{
+    for (int i = 1; i < n; i++)
+        if (v[i] < v[i - 1])
+            return 0;
+    return 1;
+}
+
+/* Função ordenar:
+   Ordena a lista de inteiros armazenada no arquivo cujo nome é passado em 'nome'.
+   Se a quantidade de números couber na Huge Page (2MB), a ordenação é feita in-memory
+   (e o arquivo não é regravado se já estava em ordem). Caso contrário, uma pré-passada
+   procura runs naturais: um arquivo já ordenado termina com uma leitura e nenhuma
+   escrita, e poucas runs naturais são intercaladas direto do arquivo para um espaço
+   novo, sem gerar runs. Se a entrada não tiver ordem aproveitável, é realizada uma
+   ordenação externa: as runs ordenadas vão para a área
+   de swap e são intercaladas k-way diretamente de volta no arquivo. Se houver mais runs
+   do que vias por thread, passadas intermediárias reduzem o número de runs antes da final.
+   Com várias threads, a geração de runs e a intercalação final são paralelas.
+   Com a saída compactada ligada (ou se o arquivo já era compactado), o resultado é
+   gravado compactado: em memória, na intercalação das runs naturais e na passada
+   final (com uma thread só, porque a saída compactada é sequencial); nos outros
+   caminhos, o arquivo é compactado depois.
+   Ao final, o tempo gasto (em ms) é exibido. */
+/* Começa a gravar a saída compactada, se pedido. Sem espaço para o pior caso, a saída
+   vai bruta e '*sem_espaco' é marcado: compactar depois também não caberia. */
+int iniciar_saida_compactada(int compactar, CompactadorSaida *c, FileEntry *novo, long elementos, int *sem_espaco)
+{
+    if (!compactar)
+        return 0;
+    if (compactador_iniciar(c, novo, elementos) == 0)
+        return 1;
+    *sem_espaco = 1;
+    return 0;
+}
+
+int ordenar(const char *nome)
+{
+    FileEntry *file = buscar_arquivo(nome);
+    if (!file)
+    {
+        mostrar("Arquivo '%s' não encontrado.\n", nome);
+        return -1;
+    }
+
+    // A ordem é conhecida: nada a ler nem a gravar (a não ser para compactar)
+    if (file->ordenado)
+    {
+        mostrar("Arquivo '%s' já está ordenado.\n", nome);
+        return compactar_saida ? converter_formato(file, FORMATO_COMPACTADO) : 0;
+    }
+
+    // A ordenação usa o maior trecho livre da reserva de huge pages
+    size_t bytes_memoria;
+    int32_t *huge_buffer = memoria_alocar_maior(&bytes_memoria);
+    if (!huge_buffer)
+    {
+        mostrar("Nenhuma huge page livre na reserva de memória.\n");
+        return -1;
+    }
+
+    // A ordenação trabalha no conteúdo bruto (só mexe no formato com a memória em mãos)
+    int compactar = compactar_saida || file->formato == FORMATO_COMPACTADO;
+    int sem_espaco_compactado = 0;
+    if (converter_formato(file, FORMATO_BRUTO) == -1)
+    {
+        memoria_liberar(huge_buffer);
+        return -1;
+    }
+
+    long total_elementos = file->size / sizeof(int32_t);
+    int entradas_indice = (int)((total_elementos + ELEMENTOS_POR_BLOCO - 1) / ELEMENTOS_POR_BLOCO);
+    int32_t *indice = malloc((entradas_indice + 1) * sizeof(int32_t));
+    if (!indice)
+    {
+        mostrar("Sem memória para o índice de '%s'.\n", nome);
+        memoria_liberar(huge_buffer);
+        return -1;
+    }
+    descartar_indice(file);
+    int capacidade_total = bytes_memoria / sizeof(int32_t);
+
+    int32_t *regioes[MAX_THREADS_ORDENACAO] = {huge_buffer};
+    int num_threads = 1;
+    int resultado = -1;
+    FileEntry novo;
+    CompactadorSaida compactador;
+
+    struct timespec inicio, fim;
+    clock_gettime(CLOCK_MONOTONIC, &inicio);
+
+    if (total_elementos <= elementos_ordenaveis(capacidade_total))
+    {
+        if (ler_arquivo(file, huge_buffer, file->size, 0) != (ssize_t)file->size)
+        {
+            mostrar("Erro ao ler o arquivo '%s'.\n", nome);
+            goto cleanup;
+        }
+        int ordenado = ja_ordenado(huge_buffer, (int)total_elementos);
+        if (!ordenado)
+            ordenar_memoria(huge_buffer, (int)total_elementos, huge_buffer + total_elementos);
+        if (iniciar_saida_compactada(compactar, &compactador, &novo, total_elementos, &sem_espaco_compactado))
+        {
+            compactador_adicionar(&compactador, huge_buffer, total_elementos);
+            if (compactador_finalizar(&compactador, file) == -1)
+                goto cleanup;
+        }
+        else if (!ordenado && escrever_arquivo(file, huge_buffer, file->size, 0) != (ssize_t)file->size)
+        {
+            mostrar("Erro de E/S ao gravar o resultado; o conteúdo de '%s' ficou incompleto.\n", nome);
+            goto cleanup;
+        }
+        for (int i = 0; i < entradas_indice; i++)
+            indice[i] = huge_buffer[(size_t)i * ELEMENTOS_POR_BLOCO];
+
+        clock_gettime(CLOCK_MONOTONIC, &fim);
+        mostrar("Ordenação concluída em %.2f ms (%s, em memória%s)\n",
+               (fim.tv_sec - inicio.tv_sec) * 1000.0 + (fim.tv_nsec - inicio.tv_nsec) / 1e6,
+               nomes_algoritmos[algoritmo_ordenacao], ordenado ? ", já estava ordenado" : "");
+        resultado = 0;
+        goto cleanup;
+    }
+
+    /* Pré-passada: runs naturais. A paginada só aproveita o caso já ordenado; as
+       outras intercalam as runs naturais se couberem em uma passada só. */
+    int max_naturais = algoritmo_ordenacao == ORDENACAO_PAGINADA ? 1 : max_vias(capacidade_total);
+    RunInfo *naturais = malloc(max_naturais * sizeof(RunInfo));
+    if (!naturais)
+    {
+        mostrar("Sem memória para as runs naturais de '%s'.\n", nome);
+        goto cleanup;
+    }
+    int num_naturais = detectar_runs_naturais(file, huge_buffer, capacidade_total, naturais, max_naturais,
+                                              indice);
+    if (num_naturais == -2)
+    {
+        mostrar("Erro ao ler o arquivo '%s'.\n", nome);
+        free(naturais);
+        goto cleanup;
+    }
+    if (num_naturais == 1 && !naturais[0].decrescente)
+    {
+        free(naturais);
+        clock_gettime(CLOCK_MONOTONIC, &fim);
+        mostrar("Ordenação concluída em %.2f ms (arquivo já estava ordenado)\n",
+               (fim.tv_sec - inicio.tv_sec) * 1000.0 + (fim.tv_nsec - inicio.tv_nsec) / 1e6);
+        resultado = 0;
+        goto cleanup;
+    }
+    int compactada = num_naturais > 0 && algoritmo_ordenacao != ORDENACAO_PAGINADA &&
+                     iniciar_saida_compactada(compactar, &compactador, &novo, total_elementos,
+                                              &sem_espaco_compactado);
+    if (compactada ||
+        (num_naturais > 0 && algoritmo_ordenacao != ORDENACAO_PAGINADA && alocar_arquivo(&novo, file->size) == 0))
+    {
+        // Intercala do arquivo para o espaço novo, que passa a ser o do arquivo
+        estat_runs(num_naturais);
+        estat_passada();
+        int falhou = intercalar_runs(naturais, num_naturais, file, 0, compactada ? NULL : &novo, indice,
+                                     compactada ? &compactador : NULL, huge_buffer, capacidade_total) == -1;
+        free(naturais);
+        if (falhou && compactada)
+            compactador_descartar(&compactador);
+        else if (compactada)
+            falhou = compactador_finalizar(&compactador, file) == -1;
+        else if (falhou)
+            liberar_arquivo(&novo);
+        else
+            substituir_conteudo(file, &novo, file->size, FORMATO_BRUTO);
+        if (falhou)
+        {
+            mostrar("Erro de E/S ao intercalar as runs naturais; '%s' ficou como estava.\n", nome);
+            goto cleanup;
+        }
+
+        clock_gettime(CLOCK_MONOTONIC, &fim);
+        mostrar("Ordenação concluída em %.2f ms (%d run(s) natural(is) intercalada(s))\n",
+               (fim.tv_sec - inicio.tv_sec) * 1000.0 + (fim.tv_nsec - inicio.tv_nsec) / 1e6, num_naturais);
+        resultado = 0;
+        goto cleanup;
+    }
+    free(naturais);
+
+    // Ordenação paginada: o próprio arquivo é o armazenamento da memória virtual
+    if (algoritmo_ordenacao == ORDENACAO_PAGINADA)
+    {
+        MemoriaVirtual *mv = mv_criar(huge_buffer, bytes_memoria, tamanho_pagina_virtual, total_elementos,
+                                      ler_arquivo, escrever_arquivo, file);
+        if (!mv)
+            goto cleanup;
+        int falhou = ordenar_paginado(mv, total_elementos) == -1;
+        for (int i = 0; i < entradas_indice && !falhou; i++)
+            indice[i] = mv_ler(mv, (long)i * ELEMENTOS_POR_BLOCO);
+        mv_sincronizar(mv);
+        falhou = falhou || mv_falhou(mv);
+        if (!falhou)
+            mv_exibir_contadores(mv);
+        mv_destruir(mv);
+        if (falhou)
+        {
+            // A ordenação é no próprio lugar: o que já foi gravado de volta não se desfaz
+            mostrar("Erro de E/S na ordenação paginada; o conteúdo de '%s' ficou incompleto.\n", nome);
+            goto cleanup;
+        }
+
+        clock_gettime(CLOCK_MONOTONIC, &fim);
+        mostrar("Ordenação concluída em %.2f ms (%s)\n",
+               (fim.tv_sec - inicio.tv_sec) * 1000.0 + (fim.tv_nsec - inicio.tv_nsec) / 1e6,
+               nomes_algoritmos[algoritmo_ordenacao]);
+        resultado = 0;
+        goto cleanup;
+    }
+
+    /* Reparte a memória: o trecho inteiro em fatias iguais ou uma huge page dele por
+       thread (tantas threads quantas huge pages o trecho tiver) */
+    int capacidade;
+    if (orcamento_por_thread)
+    {
+        int paginas = capacidade_total / CAPACIDADE;
+        num_threads = threads_ordenacao < paginas ? threads_ordenacao : paginas;
+        capacidade = CAPACIDADE;
+    }
+    else
+    {
+        num_threads = threads_ordenacao;
+        capacidade = capacidade_total / num_threads / JANELA_MINIMA * JANELA_MINIMA;
+    }
+    for (int i = 1; i < num_threads; i++)
+        regioes[i] = huge_buffer + (size_t)i * capacidade;
+
+    int areas = algoritmo_ordenacao == ORDENACAO_RADIX ? 3 : 2;
+    int fatia = capacidade / areas / JANELA_MINIMA * JANELA_MINIMA;
+    int num_runs = (int)((total_elementos + fatia - 1) / fatia);
+
+    // Reserva a swap de todas as runs antes de distribuir o trabalho
+    RunInfo *runs = reservar_runs(total_elementos, fatia, num_runs);
+    if (!runs)
+        goto cleanup;
+
+    GeracaoRuns geracao = {file, fatia, num_runs, runs, 0, 0};
+    TarefaGeracao tarefas[MAX_THREADS_ORDENACAO];
+    for (int i = 0; i < num_threads; i++)
+        tarefas[i] = (TarefaGeracao){&geracao, regioes[i]};
+    executar_em_paralelo(gerar_runs, tarefas, sizeof(TarefaGeracao), num_threads);
+    estat_runs(num_runs);
+    if (geracao.erro)
+    {
+        mostrar("Erro de E/S ao gerar as runs; '%s' ficou como estava.\n", nome);
+        liberar_swap_runs(runs, num_runs);
+        free(runs);
+        goto cleanup;
+    }
+
+    // Passadas intermediárias (com o trecho inteiro): só quando há mais runs do
+    // que vias na memória de cada thread
+    if (reduzir_runs(&runs, &num_runs, max_vias(capacidade), huge_buffer, capacidade_total) == -1)
+        goto cleanup;
+
+    /* Passada final: intercala direto nas extensões do arquivo ou, compactando, em um
+       espaço novo, com uma thread e o trecho inteiro de memória */
+    estat_passada();
+    int compactada_final = iniciar_saida_compactada(compactar, &compactador, &novo, total_elementos,
+                                                    &sem_espaco_compactado);
+    int falhou;
+    if (compactada_final)
+    {
+        falhou = intercalar_runs(runs, num_runs, NULL, 0, NULL, indice, &compactador, huge_buffer,
+                                 capacidade_total) == -1;
+        num_threads = 1;
+    }
+    else if (num_threads > 1)
+        falhou = intercalar_em_paralelo(runs, num_runs, file, indice, regioes, capacidade, num_threads) == -1;
+    else
+        falhou = intercalar_runs(runs, num_runs, NULL, 0, file, indice, NULL, huge_buffer, capacidade) == -1;
+
+    liberar_swap_runs(runs, num_runs);
+    free(runs);
+    if (compactada_final && falhou)
+        compactador_descartar(&compactador);
+    else if (compactada_final)
+        falhou = compactador_finalizar(&compactador, file) == -1;
+    if (falhou)
+    {
+        // Sem compactar, a intercalação grava por cima do arquivo: ele não fica como estava
+        mostrar(compactada_final ? "Erro de E/S na intercalação final; '%s' ficou como estava.\n"
+                                 : "Erro de E/S na intercalação final; o conteúdo de '%s' ficou incompleto.\n",
+                nome);
+        goto cleanup;
+    }
+
+    clock_gettime(CLOCK_MONOTONIC, &fim);
+    mostrar("Ordenação concluída em %.2f ms (%s, %d thread(s))\n",
+           (fim.tv_sec - inicio.tv_sec) * 1000.0 + (fim.tv_nsec - inicio.tv_nsec) / 1e6,
+           nomes_algoritmos[algoritmo_ordenacao], num_threads);
+    resultado = 0;
+
+cleanup:
+    if (resultado == 0)
+    {
+        gravar_indice(file, indice, entradas_indice);
+        sincronizar_metadados();
+    }
+    free(indice);
+    descartar_cache_arquivo(file);
+    memoria_liberar(huge_buffer);
+
+    /* Caminhos que gravaram o resultado bruto sem tentar compactar (a paginada):
+       compacta depois. O arquivo já está ordenado, então isso não falha a ordenação. */
+    if (resultado == 0 && compactar && file->formato == FORMATO_BRUTO &&
+        (sem_espaco_compactado || converter_formato(file, FORMATO_COMPACTADO) == -1))
+        mostrar("Arquivo '%s' ordenado, mas ficou sem compactação (espaço insuficiente).\n", nome);
+    return resultado;
+}
+
+int ler(const char *nome, long inicio, long fim)
+{
+    // Encontra o arquivo
+    FileEntry *file = buscar_arquivo(nome);
+    if (!file)
+    {
+        mostrar("Arquivo '%s' não encontrado.\n", nome);
+        return -1;
+    }
+
+    long num_inteiros = file->size / sizeof(uint32_t);
+
+    // Valida o intervalo
+    if (inicio < 0 || fim >= num_inteiros || inicio > fim)
+    {
+        mostrar("Intervalo inválido.\n");
+        return -1;
+    }
+
+    size_t tamanho_sublista = (fim - inicio + 1) * sizeof(uint32_t);
+
+    // Aloca buffer (sublistas curtas usam a pilha) e lê do disco
+    uint32_t local[ELEMENTOS_POR_BLOCO];
+    uint32_t *buffer = tamanho_sublista <= sizeof(local) ? local : malloc(tamanho_sublista);
+    if (!buffer)
+    {
+        perror("Erro ao alocar memória para leitura");
+        return -1;
+    }
+
+    // Do arquivo compactado, só os blocos que cobrem a sublista são lidos
+    if (ler_elementos(file, (int32_t *)buffer, inicio, fim - inicio + 1) == -1)
+    {
+        perror("Erro ao ler dados do arquivo");
+        if (buffer != local)
+            free(buffer);
+        return -1;
+    }
+
+    // Exibe a sublista
+    mostrar("Sublista de '%s' (%ld a %ld):\n", nome, inicio, fim);
+    for (long i = 0; i <= fim - inicio; i++)
+    {
+        mostrar("%u ", buffer[i]);
+    }
+    mostrar("\n");
+
+    if (buffer != local)
+        free(buffer);
+    return 0;
+}
+
+/* Primeira posição do arquivo ordenado 'f' com valor >= 'chave' (> 'chave' se
+   'estrito'); o tamanho do arquivo se não houver, ou -1 se uma leitura falhar. Com
+   índice, a busca binária roda nas primeiras chaves dos blocos e só um bloco do
+   arquivo é lido; sem ele (não coube no disco), roda direto nos elementos. */
+long limite_arquivo(const FileEntry *f, int32_t chave, int estrito)
+{
+    long n = f->size / sizeof(int32_t);
+    long lo = 0, hi = n;
+    if (f->indice_bloco >= 0)
+    {
+        // Blocos cuja primeira chave ainda fica antes da resposta
+        int a = 0, b = f->indice_entradas;
+        while (a < b)
+        {
+            int meio = a + (b - a) / 2;
+            int32_t primeira;
+            off_t pos = (off_t)f->indice_bloco * BLOCK_SIZE + meio * sizeof(int32_t);
+            if (transferir_disco(&primeira, sizeof(primeira), pos, 0) != (ssize_t)sizeof(primeira))
+                return -1;
+            if (primeira < chave || (estrito && primeira == chave))
+                a = meio + 1;
+            else
+                b = meio;
+        }
+        if (a == 0)
+            return 0;
+
+        // A resposta está no bloco a - 1 ou é o início do bloco a
+        int32_t bloco[ELEMENTOS_POR_BLOCO];
+        lo = (long)(a - 1) * ELEMENTOS_POR_BLOCO;
+        int validos = n - lo < ELEMENTOS_POR_BLOCO ? n - lo : ELEMENTOS_POR_BLOCO;
+        if (ler_elementos(f, bloco, lo, validos) == -1)
+            return -1;
+        int i = 0;
+        while (i < validos && (bloco[i] < chave || (estrito && bloco[i] == chave)))
+            i++;
+        return lo + i;
+    }
+
+    while (lo < hi)
+    {
+        long meio = lo + (hi - lo) / 2;
+        int32_t v;
+        if (ler_elementos(f, &v, meio, 1) == -1)
+            return -1;
+        if (v < chave || (estrito && v == chave))
+            lo = meio + 1;
+        else
+            hi = meio;
+    }
+    return lo;
+}
+
+/* Comando buscar: mostra os valores do arquivo ordenado que estão em [minimo, maximo],
+   achando o começo e o fim do trecho por busca binária (O(log n) leituras de bloco)
+   e lendo só o trecho. */
+int buscar(const char *nome, int minimo, int maximo)
+{
+    FileEntry *file = buscar_arquivo(nome);
+    if (!file)
+    {
+        mostrar("Arquivo '%s' não encontrado.\n", nome);
+        return -1;
+    }
+    if (!file->ordenado)
+    {
+        mostrar("Arquivo '%s' não está ordenado (use ordenar antes).\n", nome);
+        return -1;
+    }
+    if (minimo > maximo)
+    {
+        mostrar("Intervalo inválido.\n");
+        return -1;
+    }
+
+    long inicio = limite_arquivo(file, minimo, 0);
+    long fim = limite_arquivo(file, maximo, 1);
+    if (inicio == -1 || fim == -1)
+    {
+        mostrar("Erro ao ler o arquivo '%s'.\n", nome);
+        return -1;
+    }
+    mostrar("Valores de '%s' em [%d, %d]: %ld elemento(s)", nome, minimo, maximo, fim - inicio);
+    if (fim > inicio)
+        mostrar(", posições %ld a %ld", inicio, fim - 1);
+    mostrar("\n");
+
+    int32_t buffer[16 * ELEMENTOS_POR_BLOCO];
+    for (long pos = inicio; pos < fim;)
+    {
+        int n = fim - pos < 16 * ELEMENTOS_POR_BLOCO ? fim - pos : 16 * ELEMENTOS_POR_BLOCO;
+        if (ler_elementos(file, buffer, pos, n) == -1)
+        {
+            perror("Erro ao ler dados do arquivo");
+            return -1;
+        }
+        for (int i = 0; i < n; i++)
+            mostrar("%d ", buffer[i]);
+        pos += n;
+    }
+    if (fim > inicio)
+        mostrar("\n");
+    return 0;
+}
+
+/* Consultas sem ordenar: maiores/menores, quantis e histograma respondem com uma
+   leitura sequencial do arquivo, sem escrever nada nem usar a swap. O arquivo passa
+   por uma huge page da reserva em duas metades: enquanto uma é examinada, a outra é
+   lida em segundo plano (do compactado, cada metade é lida e descompactada na hora).
+   Em um arquivo já ordenado, as respostas saem direto das posições certas. */
+#define ELEMENTOS_VARREDURA ((long)(HUGE_PAGE_SIZE / 2 / sizeof(int32_t))) // Meia huge page
+#define MAX_QUANTIS 6
+#define BALDES_RADIX 65536 // Baldes pelos 16 bits altos da chave
+#define MAX_BALDES_HISTOGRAMA 1000
+
+typedef void (*VisitaVarredura)(void *contexto, const int32_t *v, long n);
+
+// Chama 'visitar' para cada trecho do arquivo, em ordem; 0 ou -1
+int varrer_arquivo(const FileEntry *f, VisitaVarredura visitar, void *contexto)
+{
+    long total = f->size / sizeof(int32_t);
+    int32_t *buffer = memoria_obter(HUGE_PAGE_SIZE, BLOCK_SIZE);
+    if (!buffer)
+    {
+        perror("Erro ao alocar memória para a varredura");
+        return -1;
+    }
+    int32_t *metades[2] = {buffer, buffer + ELEMENTOS_VARREDURA};
+    int bruto = f->formato == FORMATO_BRUTO, atual = 0, erro = 0;
+    LoteES leitura = {.n = 0};
+    if (bruto && total > 0)
+        lote_enviar(&leitura, f, metades[0], (total < ELEMENTOS_VARREDURA ? total : ELEMENTOS_VARREDURA) * sizeof(int32_t),
+                    0, 0);
+    for (long pos = 0; pos < total && !erro; pos += ELEMENTOS_VARREDURA, atual = !atual)
+    {
+        long n = total - pos < ELEMENTOS_VARREDURA ? total - pos : ELEMENTOS_VARREDURA;
+        if (bruto)
+        {
+            lote_aguardar(&leitura);
+            long seguinte = pos + n;
+            if (seguinte < total)
+            {
+                long m = total - seguinte < ELEMENTOS_VARREDURA ? total - seguinte : ELEMENTOS_VARREDURA;
+                lote_enviar(&leitura, f, metades[!atual], m * sizeof(int32_t), seguinte * sizeof(int32_t), 0);
+            }
+        }
+        else if (ler_elementos(f, metades[atual], pos, n) == -1)
+        {
+            perror("Erro ao ler dados do arquivo");
+            erro = 1;
+            break;
+        }
+        visitar(contexto, metades[atual], n);
+    }
+    lote_aguardar(&leitura);
+    memoria_devolver(buffer);
+    return erro ? -1 : 0;
+}
+
+/* Chave sem sinal com a mesma ordem dos int32_t (o bit de sinal invertido); os
+   quantis e o heap trabalham nela */
+uint32_t chave_int32(int32_t x)
+{
+    return (uint32_t)x ^ 0x80000000u;
+}
+
+int32_t valor_chave(uint32_t c)
+{
+    return (int32_t)(c ^ 0x80000000u);
+}
+
+/* Os k maiores em um heap de mínimo com k chaves: a raiz é a menor das guardadas, e
+   só quem passa dela entra. Para os k menores, as chaves são invertidas (~). */
+typedef struct
+{
+    uint32_t *heap;
+    long k, n;
+    uint32_t inverter; // 0 para os maiores, ~0 para os menores
+} Extremos;
+
+void descer_heap(uint32_t *h, long n, long i)
+{
+    uint32_t c = h[i];
+    while (2 * i + 1 < n)
+    {
+        long filho = 2 * i + 1;
+        if (filho + 1 < n && h[filho + 1] < h[filho])
+            filho++;
+        if (h[filho] >= c)
+            break;
+        h[i] = h[filho];
+        i = filho;
+    }
+    h[i] = c;
+}
+
+void visitar_extremos(void *contexto, const int32_t *v, long n)
+{
+    Extremos *e = contexto;
+    uint32_t *h = e->heap;
+    for (long i = 0; i < n; i++)
+    {
+        uint32_t c = chave_int32(v[i]) ^ e->inverter;
+        if (e->n < e->k)
+        {
+            long j = e->n++;
+            while (j > 0 && h[(j - 1) / 2] > c)
+            {
+                h[j] = h[(j - 1) / 2];
+                j = (j - 1) / 2;
+            }
+            h[j] = c;
+        }
+        else if (c > h[0])
+        {
+            h[0] = c;
+            descer_heap(h, e->k, 0);
+        }
+    }
+}
+
+int comparar_chaves_decrescente(const void *a, const void *b)
+{
+    uint32_t x = *(const uint32_t *)a, y = *(const uint32_t *)b;
+    return (x < y) - (x > y);
+}
+
+/* Comandos maiores e menores: os k maiores (em ordem decrescente) ou os k menores
+   (em ordem crescente) números do arquivo, em uma passada com memória O(k). */
+int extremos(const char *nome, long k, int maiores)
+{
+    FileEntry *file = buscar_arquivo(nome);
+    if (!file)
+    {
+        mostrar("Arquivo '%s' não encontrado.\n", nome);
+        return -1;
+    }
+    long total = file->size / sizeof(int32_t);
+    if (k <= 0)
+    {
+        mostrar("Quantidade inválida.\n");
+        return -1;
+    }
+    if (k > total)
+        k = total;
+
+    Extremos e = {malloc((k > 0 ? k : 1) * sizeof(uint32_t)), k, 0, maiores ? 0 : ~0u};
+    if (!e.heap)
+    {
+        perror("Erro ao alocar memória para a consulta");
+        return -1;
+    }
+    if (file->ordenado)
+    {
+        // Já em ordem: são os k primeiros ou os k últimos
+        int32_t *v = (int32_t *)e.heap;
+        if (ler_elementos(file, v, maiores ? total - k : 0, k) == -1)
+        {
+            perror("Erro ao ler dados do arquivo");
+            free(e.heap);
+            return -1;
+        }
+        for (long i = 0; i < k; i++)
+            e.heap[i] = chave_int32(v[i]) ^ e.inverter;
+        e.n = k;
+    }
+    else if (varrer_arquivo(file, visitar_extremos, &e) == -1)
+    {
+        free(e.heap);
+        return -1;
+    }
+    qsort(e.heap, e.n, sizeof(uint32_t), comparar_chaves_decrescente);
+
+    mostrar("Os %ld %s de '%s':\n", e.n, maiores ? "maiores" : "menores", nome);
+    for (long i = 0; i < e.n; i++)
+        mostrar("%d ", valor_chave(e.heap[i] ^ e.inverter));
+    mostrar("\n");
+    free(e.heap);
+    return 0;
+}
+
+/* Contagem por dígito de 16 bits da chave. Na primeira passada, 'alto' é -1 e a
+   contagem é pelo dígito alto de todos os números; na segunda, cada quantil ainda
+   em aberto tem a sua contagem do dígito baixo, só dos números cujo dígito alto é o
+   dele ('balde_alvo' diz qual contagem cada dígito alto alimenta, -1 nenhuma). */
+typedef struct
+{
+    long *contagens[MAX_QUANTIS];
+    signed char *balde_alvo;
+    uint32_t menor, maior; // Chaves extremas (primeira passada)
+} ContagemRadix;
+
+void visitar_digito_alto(void *contexto, const int32_t *v, long n)
+{
+    ContagemRadix *c = contexto;
+    long *baldes = c->contagens[0];
+    for (long i = 0; i < n; i++)
     {
-        fs.free_blocks[i] = 1;
+        uint32_t x = chave_int32(v[i]);
+        baldes[x >> 16]++;
+        if (x < c->menor)
+            c->menor = x;
+        if (x > c->maior)
+            c->maior = x;
     }
 }
 
-int allocate_swap_blocks(int blocks_needed)
+void visitar_digito_baixo(void *contexto, const int32_t *v, long n)
 {
-    int swap_start = (DISK_SIZE - SWAP_SIZE) / BLOCK_SIZE;
-    for (int i = swap_start; i <= (DISK_SIZE / BLOCK_SIZE) - blocks_needed; i++)
+    ContagemRadix *c = contexto;
+    for (long i = 0; i < n; i++)
     {
-        int j;
-        for (j = i; j < i + blocks_needed; j++)
-        {
-            if (fs.free_blocks[j] != 0)
-                break;
-        }
-        if (j == i + blocks_needed)
-        {
-            for (int k = i; k < i + blocks_needed; k++)
-                fs.free_blocks[k] = 1;
-            return i;
-        }
+        uint32_t x = chave_int32(v[i]);
+        int alvo = c->balde_alvo[x >> 16];
+        if (alvo >= 0)
+            c->contagens[alvo][x & 0xffff]++;
     }
-    return -1;
 }
 
-void free_swap_blocks(int start_block, int num_blocks)
+// Balde de 'baldes' onde cai a posição 'posicao' na ordem; '*antes' recebe quantos vêm antes dele
+int balde_da_posicao(const long *baldes, long posicao, long *antes)
 {
-    for (int i = start_block; i < start_block + num_blocks; i++)
-    {
-        fs.free_blocks[i] = 0;
-    }
+    long acumulado = 0;
+    int b = 0;
+    while (acumulado + baldes[b] <= posicao)
+        acumulado += baldes[b++];
+    *antes = acumulado;
+    return b;
 }
 
-/* Cria um arquivo com uma lista aleatória de números inteiros positivos de 32 bits.
-O argumento "tam" indica a quantidade de números. */
-void criar(const char *nome, int tam)
+/* Comandos quantis e estimar: o quantil q (0 a 1) é o número que fica na posição
+   round(q × (n − 1)) do arquivo ordenado, o mesmo que ler mostraria depois de
+   ordenar. quantis acha o valor exato por seleção radix, sem ordenar: uma passada
+   conta os números pelos 16 bits altos e localiza o balde de cada quantil; outra
+   conta, só dentro desses baldes, os 16 bits baixos. estimar para na primeira
+   passada (o histograma de 65536 baldes é o esboço) e interpola dentro do balde,
+   mostrando o intervalo onde o valor exato com certeza está. */
+int quantis(const char *nome, const double *q, int num_quantis, int aproximado)
 {
-    if (fs.file_count >= MAX_FILES)
+    FileEntry *file = buscar_arquivo(nome);
+    if (!file)
     {
-        printf("Número máximo de arquivos atingido.\n");
-        return;
+        mostrar("Arquivo '%s' não encontrado.\n", nome);
+        return -1;
     }
-
-    int blocks_needed = (tam * sizeof(uint32_t) + BLOCK_SIZE - 1) / BLOCK_SIZE;
-    int total_blocks = (DISK_SIZE - SWAP_SIZE) / BLOCK_SIZE; // Ignorar área de swap
-    int start_block = -1;
-
-    for (int i = 0; i <= total_blocks - blocks_needed; i++)
+    long total = file->size / sizeof(int32_t);
+    if (total == 0)
     {
-        int j;
-        for (j = i; j < i + blocks_needed; j++)
-        {
-            if (fs.free_blocks[j] != 0)
-                break;
-        }
-        if (j == i + blocks_needed)
+        mostrar("Arquivo '%s' está vazio.\n", nome);
+        return -1;
+    }
+    if (num_quantis > MAX_QUANTIS)
+    {
+        mostrar("No máximo %d quantis por consulta.\n", MAX_QUANTIS);
+        return -1;
+    }
+    long posicoes[MAX_QUANTIS];
+    for (int i = 0; i < num_quantis; i++)
+    {
+        if (!(q[i] >= 0.0 && q[i] <= 1.0))
         {
-            start_block = i;
-            break;
+            mostrar("Quantil inválido (use valores de 0 a 1).\n");
+            return -1;
         }
+        posicoes[i] = (long)(q[i] * (total - 1) + 0.5);
     }
 
-    if (start_block == -1)
+    // Arquivo ordenado: cada quantil é uma leitura
+    if (file->ordenado)
     {
-        printf("Espaço insuficiente no disco.\n");
-        return;
+        for (int i = 0; i < num_quantis; i++)
+        {
+            int32_t v;
+            if (ler_elementos(file, &v, posicoes[i], 1) == -1)
+            {
+                perror("Erro ao ler dados do arquivo");
+                return -1;
+            }
+            mostrar("Quantil %g de '%s' (posição %ld): %d\n", q[i], nome, posicoes[i], v);
+        }
+        return 0;
     }
 
-    for (int i = start_block; i < start_block + blocks_needed; i++)
+    ContagemRadix c = {{calloc(BALDES_RADIX, sizeof(long))}, NULL, UINT32_MAX, 0};
+    int resultado = -1;
+    if (!c.contagens[0])
     {
-        fs.free_blocks[i] = 1;
+        perror("Erro ao alocar memória para a consulta");
+        return -1;
     }
+    if (varrer_arquivo(file, visitar_digito_alto, &c) == -1)
+        goto cleanup;
 
-    strncpy(fs.files[fs.file_count].name, nome, FILE_NAME_SIZE);
-    fs.files[fs.file_count].size = tam * sizeof(uint32_t);
-    fs.files[fs.file_count].start_block = start_block;
-    fs.file_count++;
+    long antes[MAX_QUANTIS];
+    int altos[MAX_QUANTIS];
+    for (int i = 0; i < num_quantis; i++)
+        altos[i] = balde_da_posicao(c.contagens[0], posicoes[i], &antes[i]);
 
-    lseek(disk_fd, start_block * BLOCK_SIZE, SEEK_SET);
-    for (int i = 0; i < tam; i++)
+    if (aproximado)
     {
-        uint32_t num = 0;
-        for (int j = 0; j < 4; j++)
+        for (int i = 0; i < num_quantis; i++)
         {
-            num = (num << 8) | (rand() % 256);
+            // Interpola entre as chaves do balde que de fato existem no arquivo
+            uint32_t inicio = (uint32_t)altos[i] << 16, fim = inicio | 0xffff;
+            if (inicio < c.menor)
+                inicio = c.menor;
+            if (fim > c.maior)
+                fim = c.maior;
+            long no_balde = c.contagens[0][altos[i]];
+            uint32_t estimado = inicio + (uint32_t)(((double)(posicoes[i] - antes[i]) + 0.5) / no_balde *
+                                                    ((double)fim - inicio + 1));
+            if (estimado > fim)
+                estimado = fim;
+            mostrar("Quantil %g de '%s' (posição %ld): ~%d (entre %d e %d)\n", q[i], nome, posicoes[i],
+                    valor_chave(estimado), valor_chave(inicio), valor_chave(fim));
         }
-        write(disk_fd, &num, sizeof(uint32_t));
+        resultado = 0;
+        goto cleanup;
     }
 
-    printf("Arquivo '%s' criado com sucesso.\n", nome);
-}
-
-// Apaga um arquivo
-void apagar(const char *nome)
-{
-    for (int i = 0; i < fs.file_count; i++)
+    // Segunda passada: uma contagem dos 16 bits baixos por balde alto distinto
+    c.balde_alvo = malloc(BALDES_RADIX);
+    if (!c.balde_alvo)
+        goto cleanup;
+    memset(c.balde_alvo, -1, BALDES_RADIX);
+    long *primeira = c.contagens[0];
+    c.contagens[0] = NULL;
+    int alvos = 0, alvo_do_quantil[MAX_QUANTIS];
+    for (int i = 0; i < num_quantis; i++)
     {
-        if (strcmp(fs.files[i].name, nome) == 0)
+        if (c.balde_alvo[altos[i]] < 0)
         {
-            // Libera os blocos
-            for (int j = fs.files[i].start_block; j < fs.files[i].start_block + (fs.files[i].size + BLOCK_SIZE - 1) / BLOCK_SIZE; j++)
-            {
-                fs.free_blocks[j] = 0;
-            }
-            // Remove a entrada do arquivo
-            memmove(&fs.files[i], &fs.files[i + 1], (fs.file_count - i - 1) * sizeof(FileEntry));
-            fs.file_count--;
-            printf("Arquivo '%s' apagado com sucesso.\n", nome);
-            return;
+            c.contagens[alvos] = calloc(BALDES_RADIX, sizeof(long));
+            c.balde_alvo[altos[i]] = alvos++;
         }
+        alvo_do_quantil[i] = c.balde_alvo[altos[i]];
     }
-    printf("Arquivo '%s' não encontrado.\n", nome);
-}
+    free(primeira);
+    for (int i = 0; i < alvos; i++)
+        if (!c.contagens[i])
+        {
+            perror("Erro ao alocar memória para a consulta");
+            goto cleanup;
+        }
+    if (varrer_arquivo(file, visitar_digito_baixo, &c) == -1)
+        goto cleanup;
 
-/* Lista os arquivos
-Mostra, ao lado de cada arquivo, o seu tamanho em bytes.
-Também mostra o espaço total do "disco" e o espaço disponível. */
-void listar()
-{
-    printf("Arquivos no diretório:\n");
-    for (int i = 0; i < fs.file_count; i++)
+    for (int i = 0; i < num_quantis; i++)
     {
-        printf("%s\t%d bytes\n", fs.files[i].name, fs.files[i].size);
+        long antes_baixo;
+        int baixo = balde_da_posicao(c.contagens[alvo_do_quantil[i]], posicoes[i] - antes[i], &antes_baixo);
+        mostrar("Quantil %g de '%s' (posição %ld): %d\n", q[i], nome, posicoes[i],
+                valor_chave((uint32_t)altos[i] << 16 | baixo));
     }
+    resultado = 0;
 
-    // Calcula o espaço total e o espaço disponível
-    long espaco_total = DISK_SIZE;
-    long espaco_usado = 0;
+cleanup:
+    for (int i = 0; i < MAX_QUANTIS; i++)
+        free(c.contagens[i]);
+    free(c.balde_alvo);
+    return resultado;
+}
 
-    for (int i = 0; i < fs.file_count; i++)
+// Histograma de largura fixa: o balde de x é (x − mínimo) × baldes / (máximo − mínimo + 1)
+typedef struct
+{
+    long *baldes;
+    int num_baldes;
+    int64_t minimo, largura; // largura = máximo − mínimo + 1
+    long abaixo, acima;      // Números fora da faixa
+} Histograma;
+
+void visitar_histograma(void *contexto, const int32_t *v, long n)
+{
+    Histograma *h = contexto;
+    for (long i = 0; i < n; i++)
     {
-        espaco_usado += fs.files[i].size;
+        int64_t d = (int64_t)v[i] - h->minimo;
+        if (d < 0)
+            h->abaixo++;
+        else if (d >= h->largura)
+            h->acima++;
+        else
+            h->baldes[d * h->num_baldes / h->largura]++;
     }
-
-    long espaco_disponivel = espaco_total - espaco_usado;
-
-    printf("\nEspaço total do disco: %ld bytes (%.2f MB)\n", espaco_total, (double)espaco_total / (1024 * 1024));
-    printf("Espaço utilizado: %ld bytes (%.2f MB)\n", espaco_usado, (double)espaco_usado / (1024 * 1024));
-    printf("Espaço disponível: %ld bytes (%.2f MB)\n", espaco_disponivel, (double)espaco_disponivel / (1024 * 1024));
 }
 
-// Função de comparação para int32_t (números com sinal)
-int comparar_int32(const void *a, const void *b)
+// Primeiro valor do balde 'b'
+int64_t inicio_balde(const Histograma *h, int b)
 {
-    int32_t n1 = *(const int32_t *)a;
-    int32_t n2 = *(const int32_t *)b;
-    return (n1 > n2) - (n1 < n2);
+    return h->minimo + ((int64_t)b * h->largura + h->num_baldes - 1) / h->num_baldes;
 }
 
-RunInfo merge_two_runs(RunInfo run1, RunInfo run2, int32_t *buffer)
+/* Comando histograma: conta os números de 'nome' em 'num_baldes' faixas de mesma
+   largura entre 'minimo' e 'maximo' (sem faixa, entre o menor e o maior número do
+   arquivo, o que custa uma passada a mais se ele não estiver ordenado). Em arquivo
+   ordenado, cada balde sai de duas buscas binárias, como em buscar. */
+int histograma(const char *nome, int num_baldes, int com_faixa, int32_t minimo, int32_t maximo)
 {
-    RunInfo merged;
-    merged.num_elements = run1.num_elements + run2.num_elements;
-    int bytes_needed = merged.num_elements * sizeof(int32_t);
-    merged.num_blocks = (bytes_needed + BLOCK_SIZE - 1) / BLOCK_SIZE;
-
-    merged.start_block = allocate_swap_blocks(merged.num_blocks);
-    if (merged.start_block == -1)
+    FileEntry *file = buscar_arquivo(nome);
+    if (!file)
+    {
+        mostrar("Arquivo '%s' não encontrado.\n", nome);
+        return -1;
+    }
+    long total = file->size / sizeof(int32_t);
+    if (num_baldes < 1 || num_baldes > MAX_BALDES_HISTOGRAMA || (com_faixa && minimo > maximo))
+    {
+        mostrar("Parâmetros inválidos (1 a %d baldes, mínimo <= máximo).\n", MAX_BALDES_HISTOGRAMA);
+        return -1;
+    }
+    if (total == 0)
     {
-        merged.num_blocks = 0;
-        return merged;
+        mostrar("Arquivo '%s' está vazio.\n", nome);
+        return -1;
     }
 
-    int32_t *data1 = malloc(run1.num_elements * sizeof(int32_t));
-    int32_t *data2 = malloc(run2.num_elements * sizeof(int32_t));
+    if (!com_faixa && file->ordenado)
+    {
+        if (ler_elementos(file, &minimo, 0, 1) == -1 || ler_elementos(file, &maximo, total - 1, 1) == -1)
+        {
+            perror("Erro ao ler dados do arquivo");
+            return -1;
+        }
+    }
+    else if (!com_faixa)
+    {
+        ContagemRadix c = {{calloc(BALDES_RADIX, sizeof(long))}, NULL, UINT32_MAX, 0};
+        int r = c.contagens[0] ? varrer_arquivo(file, visitar_digito_alto, &c) : -1;
+        free(c.contagens[0]);
+        if (r == -1)
+            return -1;
+        minimo = valor_chave(c.menor);
+        maximo = valor_chave(c.maior);
+    }
 
-    lseek(disk_fd, run1.start_block * BLOCK_SIZE, SEEK_SET);
-    read(disk_fd, data1, run1.num_elements * sizeof(int32_t));
-    lseek(disk_fd, run2.start_block * BLOCK_SIZE, SEEK_SET);
-    read(disk_fd, data2, run2.num_elements * sizeof(int32_t));
+    Histograma h = {NULL, num_baldes, minimo, (int64_t)maximo - minimo + 1, 0, 0};
+    if (h.num_baldes > h.largura)
+        h.num_baldes = h.largura; // Nenhum balde vazio por construção
+    h.baldes = calloc(h.num_baldes, sizeof(long));
+    if (!h.baldes)
+    {
+        perror("Erro ao alocar memória para a consulta");
+        return -1;
+    }
+    if (file->ordenado)
+    {
+        long primeiro = limite_arquivo(file, minimo, 0), ultimo = limite_arquivo(file, maximo, 1);
+        h.abaixo = primeiro;
+        h.acima = total - ultimo;
+        for (int b = 0; b < h.num_baldes && primeiro != -1 && ultimo != -1; b++)
+        {
+            long fim = b + 1 < h.num_baldes ? limite_arquivo(file, (int32_t)inicio_balde(&h, b + 1), 0) : ultimo;
+            h.baldes[b] = fim - primeiro;
+            primeiro = fim;
+        }
+        if (primeiro == -1 || ultimo == -1)
+        {
+            mostrar("Erro ao ler o arquivo '%s'.\n", nome);
+            free(h.baldes);
+            return -1;
+        }
+    }
+    else if (varrer_arquivo(file, visitar_histograma, &h) == -1)
+    {
+        free(h.baldes);
+        return -1;
+    }
 
-    int i = 0, j = 0, k = 0;
-    while (i < run1.num_elements && j < run2.num_elements)
+    long maior = 1;
+    for (int b = 0; b < h.num_baldes; b++)
+        if (h.baldes[b] > maior)
+            maior = h.baldes[b];
+    mostrar("Histograma de '%s' em [%d, %d] (%ld números):\n", nome, minimo, maximo, total);
+    for (int b = 0; b < h.num_baldes; b++)
     {
-        buffer[k++] = (data1[i] <= data2[j]) ? data1[i++] : data2[j++];
+        int64_t fim = b + 1 < h.num_baldes ? inicio_balde(&h, b + 1) - 1 : maximo;
+        mostrar("[%11ld, %11ld] %10ld %5.1f%% ", (long)inicio_balde(&h, b), (long)fim, h.baldes[b],
+                100.0 * h.baldes[b] / total);
+        for (int i = 0; i < (int)(40 * h.baldes[b] / maior); i++)
+            mostrar("#");
+        mostrar("\n");
     }
-    while (i < run1.num_elements)
-        buffer[k++] = data1[i++];
-    while (j < run2.num_elements)
-        buffer[k++] = data2[j++];
+    if (h.abaixo || h.acima)
+        mostrar("Fora da faixa: %ld abaixo, %ld acima.\n", h.abaixo, h.acima);
+    free(h.baldes);
+    return 0;
+}
 
-    lseek(disk_fd, merged.start_block * BLOCK_SIZE, SEEK_SET);
-    write(disk_fd, buffer, bytes_needed);
+/* Operações de conjunto sobre arquivos ordenados: as entradas passam pelos cursores
+   e pela árvore de perdedores da intercalação (janelas fixas na memória da reserva,
+   com a próxima fatia de cada entrada lida em segundo plano) e o resultado vai, já em
+   ordem e com índice, para um arquivo novo. Os números iguais saem juntos da árvore:
+   cada valor é gravado no máximo uma vez, conforme as entradas em que apareceu. Uma
+   entrada fora de ordem não muda: ela é ordenada em runs na swap, cada run vira uma
+   via da árvore e todas contam como a mesma entrada. */
+#define OPERACAO_INTERCALAR 0 // Todos os números das entradas, com as repetições
+#define OPERACAO_UNIAO 1      // Valores de alguma entrada (com uma só, tira as repetições)
+#define OPERACAO_INTERSECAO 2 // Valores de todas as entradas
+#define OPERACAO_DIFERENCA 3  // Valores da primeira entrada que não estão nas outras
+#define MAX_ENTRADAS_CONJUNTO 32
 
-    free_swap_blocks(run1.start_block, run1.num_blocks);
-    free_swap_blocks(run2.start_block, run2.num_blocks);
-    free(data1);
-    free(data2);
+const char *nomes_operacoes[] = {"Intercalação", "União", "Interseção", "Diferença"};
 
-    return merged;
+// Um valor que apareceu nas entradas de 'presenca' (bit i = entrada i) vai para a saída?
+int valor_entra(int operacao, uint64_t presenca, int k)
+{
+    if (operacao == OPERACAO_INTERSECAO)
+        return presenca == (1ull << k) - 1;
+    if (operacao == OPERACAO_DIFERENCA)
+        return presenca == 1;
+    return presenca != 0;
 }
 
-/* Função ordenar:
-   Ordena a lista de inteiros armazenada no arquivo cujo nome é passado em 'nome'.
-   Se a quantidade de números couber na Huge Page (2MB), a ordenação é feita in-memory;
-   caso contrário, é realizada uma ordenação externa usando paginação com runs temporárias.
-   Ao final, o tempo gasto (em ms) é exibido. */
-void ordenar(const char *nome)
+// Sem a entrada 'i', nada mais vai para a saída: quando ela acaba, a operação para
+int entrada_necessaria(int operacao, int i)
+{
+    return operacao == OPERACAO_INTERSECAO || (operacao == OPERACAO_DIFERENCA && i == 0);
+}
+
+/* Grava em 'destino' (um arquivo novo) o resultado da 'operacao' sobre as k entradas.
+   O destino é criado com o espaço do pior caso e aparado no fim. */
+int operacao_conjunto(int operacao, const char *destino, char **entradas, int k)
 {
-    int file_idx = -1;
-    for (int i = 0; i < fs.file_count; i++)
+    if (k < (operacao == OPERACAO_UNIAO ? 1 : 2) || k > MAX_ENTRADAS_CONJUNTO)
+    {
+        mostrar("Número de entradas inválido (%d a %d).\n", operacao == OPERACAO_UNIAO ? 1 : 2,
+                MAX_ENTRADAS_CONJUNTO);
+        return -1;
+    }
+
+    // Nenhuma operação produz mais números que isto
+    long limite = 0;
+    for (int i = 0; i < k; i++)
     {
-        if (strcmp(fs.files[i].name, nome) == 0)
+        FileEntry *f = buscar_arquivo(entradas[i]);
+        if (!f)
         {
-            file_idx = i;
-            break;
+            mostrar("Arquivo '%s' não encontrado.\n", entradas[i]);
+            return -1;
         }
+        long elementos = f->size / sizeof(int32_t);
+        if (operacao == OPERACAO_INTERCALAR || operacao == OPERACAO_UNIAO)
+            limite += elementos;
+        else if (i == 0 || (operacao == OPERACAO_INTERSECAO && elementos < limite))
+            limite = elementos;
     }
-    if (file_idx == -1)
+
+    // Cria o destino como criar (o diretório pode crescer e mudar as entradas de lugar)
+    pthread_mutex_lock(&trava_metadados);
+    if (diretorio_precisa_crescer() && !comando_exclusivo())
     {
-        printf("Arquivo '%s' não encontrado.\n", nome);
-        return;
+        pthread_mutex_unlock(&trava_metadados);
+        return REPETIR_EXCLUSIVO;
     }
-
-    FileEntry *file = &fs.files[file_idx];
-    int total_elementos = file->size / sizeof(int32_t);
-    int32_t *huge_buffer = (int32_t *)alocar_huge_page();
-
-    if (!huge_buffer)
+    FileEntry *arquivo = reservar_entrada(destino);
+    if (!arquivo)
     {
-        verificar_config_hugepage();
-        printf("Falha crítica: Não foi possível alocar a Huge Page!\n");
-        return;
+        pthread_mutex_unlock(&trava_metadados);
+        return -1;
     }
-
-    int precisa_liberar = 1;
-
-    if (total_elementos <= CAPACIDADE)
+    if (alocar_arquivo(arquivo, limite * sizeof(int32_t)) == -1)
     {
-        lseek(disk_fd, file->start_block * BLOCK_SIZE, SEEK_SET);
-        read(disk_fd, huge_buffer, file->size);
-        qsort(huge_buffer, total_elementos, sizeof(int32_t), comparar_int32);
-        lseek(disk_fd, file->start_block * BLOCK_SIZE, SEEK_SET);
-        write(disk_fd, huge_buffer, file->size);
-        goto cleanup;
+        pthread_mutex_unlock(&trava_metadados);
+        mostrar("Espaço insuficiente no disco.\n");
+        return -1;
     }
+    arquivo->size = 0;
+    ocupar_entrada(arquivo, destino);
+    pthread_mutex_unlock(&trava_metadados);
 
-    clock_t inicio = clock();
-    int num_runs = (total_elementos + CAPACIDADE - 1) / CAPACIDADE;
-    RunInfo *runs = malloc(num_runs * sizeof(RunInfo));
-
-    for (int i = 0; i < num_runs; i++)
-    {
-        int elementos = (i == num_runs - 1) ? (total_elementos % CAPACIDADE) : CAPACIDADE;
-        off_t offset = file->start_block * BLOCK_SIZE + (i * CAPACIDADE * sizeof(int32_t));
+    struct timespec inicio, fim;
+    clock_gettime(CLOCK_MONOTONIC, &inicio);
 
-        lseek(disk_fd, offset, SEEK_SET);
-        read(disk_fd, huge_buffer, elementos * sizeof(int32_t));
-        qsort(huge_buffer, elementos, sizeof(int32_t), comparar_int32);
+    FileEntry *arquivos[MAX_ENTRADAS_CONJUNTO];
+    for (int i = 0; i < k; i++)
+        arquivos[i] = buscar_arquivo(entradas[i]);
 
-        int blocos = (elementos * sizeof(int32_t) + BLOCK_SIZE - 1) / BLOCK_SIZE;
-        int bloco_inicial = allocate_swap_blocks(blocos);
+    int entradas_indice = (int)((limite + ELEMENTOS_POR_BLOCO - 1) / ELEMENTOS_POR_BLOCO);
+    int32_t *indice = malloc((entradas_indice + 1) * sizeof(int32_t));
+    if (!indice)
+    {
+        perror("Erro ao alocar memória para o índice");
+        goto falha;
+    }
+    size_t bytes_memoria;
+    int32_t *buffer = memoria_alocar_maior(&bytes_memoria);
+    if (!buffer)
+    {
+        mostrar("Nenhuma huge page livre na reserva de memória.\n");
+        free(indice);
+        goto falha;
+    }
+    int capacidade = bytes_memoria / sizeof(int32_t);
 
-        lseek(disk_fd, bloco_inicial * BLOCK_SIZE, SEEK_SET);
-        write(disk_fd, huge_buffer, elementos * sizeof(int32_t));
+    /* Vias da árvore: uma por entrada ordenada e uma por run das outras. Se passarem
+       do que cabe na memória, as runs da entrada com mais delas são intercaladas antes. */
+    RunInfo *runs[MAX_ENTRADAS_CONJUNTO] = {NULL};
+    int num_runs[MAX_ENTRADAS_CONJUNTO];
+    CursorRun *cursores = NULL;
+    int *arvore = NULL, *entrada_da_via = NULL;
+    int vias = 0, resultado = -1;
+    long lidos = 0, gravados = 0;
+    for (int i = 0; i < k; i++)
+    {
+        num_runs[i] = 1;
+        if (!arquivos[i]->ordenado && !(runs[i] = ordenar_em_runs(arquivos[i], buffer, capacidade, &num_runs[i])))
+            goto liberar;
+        vias += num_runs[i];
+    }
+    while (vias > max_vias(capacidade))
+    {
+        int m = 0;
+        for (int i = 1; i < k; i++)
+            if (num_runs[i] > num_runs[m])
+                m = i;
+        if (num_runs[m] == 1)
+            break; // Uma via por entrada sempre cabe (MAX_ENTRADAS_CONJUNTO é bem menor)
+        int antes = num_runs[m], alvo = num_runs[m] - (vias - max_vias(capacidade));
+        if (reduzir_runs(&runs[m], &num_runs[m], alvo > 1 ? alvo : 1, buffer, capacidade) == -1)
+            goto liberar;
+        vias -= antes - num_runs[m];
+    }
 
-        runs[i] = (RunInfo){bloco_inicial, blocos, elementos};
+    int janela = janela_por_via(vias, capacidade);
+    cursores = malloc((vias + 1) * sizeof(CursorRun));
+    arvore = malloc((vias + 1) * sizeof(int));
+    entrada_da_via = malloc((vias + 1) * sizeof(int));
+    if (!cursores || !arvore || !entrada_da_via)
+    {
+        perror("Erro ao alocar memória para a intercalação");
+        goto liberar;
+    }
+    int32_t *base_saida = buffer + (size_t)2 * vias * janela;
+    JanelaSaida saida = {{base_saida, base_saida + janela}, 0, janela, 0, {{{0}, 0}, {{0}, 0}}, arquivo, 0,
+                         indice, NULL, 0};
+    int restantes[MAX_ENTRADAS_CONJUNTO]; // Vias de cada entrada que ainda têm números
+    for (int i = 0, v = 0; i < k; i++)
+    {
+        restantes[i] = num_runs[i];
+        for (int r = 0; r < num_runs[i]; r++, v++)
+        {
+            int32_t *base = buffer + (size_t)2 * v * janela;
+            if (runs[i])
+                cursores[v] = (CursorRun){{base, base + janela}, 1, janela, 0, 0, {{0}, 0}, 0,
+                                          (off_t)runs[i][r].start_block * BLOCK_SIZE, runs[i][r].num_elements, NULL, 0,
+                                          0};
+            else
+                cursores[v] = (CursorRun){{base, base + janela}, 1, janela, 0, 0, {{0}, 0}, 0, 0,
+                                          arquivos[i]->size / sizeof(int32_t), arquivos[i], 0, 0};
+            entrada_da_via[v] = i;
+            antecipar_cursor(&cursores[v]);
+        }
+    }
+    int erro = 0; // Uma leitura de entrada falhou: a operação para e falha
+    for (int v = 0; v < vias; v++)
+    {
+        recarregar_cursor(&cursores[v]);
+        erro |= cursores[v].erro;
+        if (cursores[v].validos == 0)
+            restantes[entrada_da_via[v]]--;
     }
+    int encerrar = 0; // Acabou uma entrada necessária
+    for (int i = 0; i < k; i++)
+        if (restantes[i] == 0 && entrada_necessaria(operacao, i))
+            encerrar = 1;
+    if (vias > 0)
+        montar_arvore(cursores, vias, arvore);
 
-    while (num_runs > 1)
+    long inicio_estat = estat_agora();
+    uint64_t presenca = 0; // Entradas em que o valor corrente já apareceu
+    int32_t valor = 0;
+    while (vias > 0 && !erro)
     {
-        int new_runs = (num_runs + 1) / 2;
-        RunInfo *new_runs_arr = malloc(new_runs * sizeof(RunInfo));
+        int w = arvore[0];
+        CursorRun *c = &cursores[w];
+        int esgotadas = c->pos >= c->validos;
 
-        for (int i = 0; i < num_runs; i += 2)
+        // Um valor diferente (ou o fim) fecha o grupo dos iguais ao corrente
+        if (presenca && (esgotadas || c->janelas[c->atual][c->pos] != valor))
         {
-            if (i + 1 >= num_runs)
+            if (valor_entra(operacao, presenca, k))
             {
-                new_runs_arr[i / 2] = runs[i];
-                continue;
+                gravar_na_saida(&saida, valor);
+                gravados++;
             }
-            new_runs_arr[i / 2] = merge_two_runs(runs[i], runs[i + 1], huge_buffer);
+            presenca = 0;
         }
+        if (esgotadas || (encerrar && !presenca))
+            break;
 
-        free(runs);
-        runs = new_runs_arr;
-        num_runs = new_runs;
+        valor = c->janelas[c->atual][c->pos++];
+        lidos++;
+        if (operacao == OPERACAO_INTERCALAR)
+        {
+            gravar_na_saida(&saida, valor);
+            gravados++;
+        }
+        else
+            presenca |= 1ull << entrada_da_via[w];
+        if (c->pos >= c->validos)
+        {
+            recarregar_cursor(c);
+            erro = c->erro;
+            int e = entrada_da_via[w];
+            if (c->pos >= c->validos && --restantes[e] == 0 && entrada_necessaria(operacao, e))
+                encerrar = 1;
+        }
+        refazer_caminho(cursores, vias, arvore, w);
     }
+    if (finalizar_saida(&saida) == -1)
+        erro = 1;
+    for (int v = 0; v < vias; v++)
+        lote_aguardar(&cursores[v].leitura); // Parando antes do fim, há leituras a caminho
+    estat_intercalacao(lidos, estat_agora() - inicio_estat);
+    if (erro)
+        mostrar("Erro ao ler as entradas da operação.\n");
+    else
+        resultado = 0;
 
-    if (runs[0].num_elements != total_elementos)
+liberar:
+    free(entrada_da_via);
+    free(arvore);
+    free(cursores);
+    for (int i = 0; i < k; i++)
     {
-        printf("Erro: Dados corrompidos durante a ordenação!\n");
-        goto cleanup;
+        if (runs[i])
+            liberar_swap_runs(runs[i], num_runs[i]);
+        free(runs[i]);
+    }
+    memoria_liberar(buffer);
+    if (resultado == -1)
+    {
+        free(indice);
+        goto falha;
     }
 
-    lseek(disk_fd, runs[0].start_block * BLOCK_SIZE, SEEK_SET);
-    read(disk_fd, huge_buffer, runs[0].num_elements * sizeof(int32_t));
-    lseek(disk_fd, file->start_block * BLOCK_SIZE, SEEK_SET);
-    write(disk_fd, huge_buffer, file->size);
-
-    free_swap_blocks(runs[0].start_block, runs[0].num_blocks);
-    free(runs);
+    aparar_arquivo(arquivo, gravados * sizeof(int32_t));
+    arquivo->size = gravados * sizeof(int32_t);
+    descartar_cache_arquivo(arquivo);
+    gravar_indice(arquivo, indice, (int)((gravados + ELEMENTOS_POR_BLOCO - 1) / ELEMENTOS_POR_BLOCO));
+    free(indice);
+    sincronizar_metadados();
+    if (compactar_saida && converter_formato(arquivo, FORMATO_COMPACTADO) == -1)
+        return -1;
 
-    printf("Ordenação concluída em %.2f ms\n",
-           (double)(clock() - inicio) * 1000 / CLOCKS_PER_SEC);
+    clock_gettime(CLOCK_MONOTONIC, &fim);
+    mostrar("%s de %d arquivo(s) gravada em '%s': %ld números (%ld lidos) em %.2f ms\n", nomes_operacoes[operacao],
+            k, destino, gravados, lidos,
+            (fim.tv_sec - inicio.tv_sec) * 1000.0 + (fim.tv_nsec - inicio.tv_nsec) / 1e6);
+    return 0;
 
-cleanup:
-    if (precisa_liberar)
-    {
-        liberar_huge_page(huge_buffer);
-    }
+falha:
+    liberar_arquivo(arquivo);
+    remover_entrada(arquivo);
+    sincronizar_metadados();
+    return -1;
 }
 
-void ler(const char *nome, int inicio, int fim)
+#define BUFFER_COPIA (1024 * 1024)
+
+/* Concatenação quando as extensões dos dois arquivos não cabem em uma entrada:
+   copia o conteúdo, em pedaços, para um espaço novo, que passa a ser o do primeiro
+   arquivo. Os blocos antigos dos dois são liberados. */
+int concatenar_copiando(FileEntry *file1, FileEntry *file2, long total_size)
 {
-    // Encontra o arquivo
-    int file_index = -1;
-    for (int i = 0; i < fs.file_count; i++)
+    FileEntry novo;
+    if (alocar_arquivo(&novo, total_size) == -1)
     {
-        if (strcmp(fs.files[i].name, nome) == 0)
-        {
-            file_index = i;
-            break;
-        }
+        mostrar("Espaço insuficiente para o arquivo concatenado.\n");
+        return -1;
     }
-    if (file_index == -1)
+
+    char *buffer = memoria_obter(BUFFER_COPIA, BLOCK_SIZE);
+    if (!buffer)
     {
-        printf("Arquivo '%s' não encontrado.\n", nome);
-        return;
+        perror("Erro ao alocar memória para concatenação");
+        liberar_arquivo(&novo);
+        return -1;
     }
 
-    FileEntry *file = &fs.files[file_index];
-    int num_inteiros = file->size / sizeof(uint32_t);
-
-    // Valida o intervalo
-    if (inicio < 0 || fim >= num_inteiros || inicio > fim)
+    FileEntry *origens[2] = {file1, file2};
+    off_t destino = 0;
+    for (int o = 0; o < 2; o++)
     {
-        printf("Intervalo inválido.\n");
-        return;
+        for (off_t pos = 0; pos < origens[o]->size; pos += BUFFER_COPIA)
+        {
+            size_t n = origens[o]->size - pos < BUFFER_COPIA ? origens[o]->size - pos : BUFFER_COPIA;
+            if (ler_arquivo(origens[o], buffer, n, pos) != (ssize_t)n ||
+                escrever_arquivo(&novo, buffer, n, destino) != (ssize_t)n)
+            {
+                perror("Erro ao copiar arquivo concatenado");
+                liberar_arquivo(&novo);
+                memoria_devolver(buffer);
+                return -1;
+            }
+            destino += n;
+        }
     }
+    memoria_devolver(buffer);
+    descartar_cache_arquivo(file1);
+    descartar_cache_arquivo(file2);
+    descartar_cache_arquivo(&novo);
 
-    // Calcula o offset no disco
-    off_t offset = file->start_block * BLOCK_SIZE + inicio * sizeof(uint32_t);
-    int tamanho_sublista = (fim - inicio + 1) * sizeof(uint32_t);
+    liberar_arquivo(file1);
+    liberar_arquivo(file2);
+    file1->num_extensoes = novo.num_extensoes;
+    memcpy(file1->extensoes, novo.extensoes, novo.num_extensoes * sizeof(Extensao));
+    return 0;
+}
 
-    // Aloca buffer e lê do disco
-    uint32_t *buffer = malloc(tamanho_sublista);
-    if (!buffer)
+/* Concatena dois arquivos em um, com o nome do primeiro. Normalmente só muda os
+   metadados: as extensões do segundo são anexadas à lista do primeiro, sem copiar
+   dados nem precisar de espaço contíguo livre. */
+int concatenar(const char *nome1, const char *nome2)
+{
+    FileEntry *file1 = buscar_arquivo(nome1);
+    FileEntry *file2 = buscar_arquivo(nome2);
+    if (!file1 || !file2)
     {
-        perror("Erro ao alocar memória para leitura");
-        return;
+        mostrar("Arquivo(s) não encontrado(s).\n");
+        return -1;
     }
 
-    lseek(disk_fd, offset, SEEK_SET);
-    if (read(disk_fd, buffer, tamanho_sublista) != tamanho_sublista)
+    if (file1 == file2)
     {
-        perror("Erro ao ler dados do arquivo");
-        free(buffer);
-        return;
+        mostrar("Não é possível concatenar um arquivo com ele mesmo.\n");
+        return -1;
     }
 
-    // Exibe a sublista
-    printf("Sublista de '%s' (%d a %d):\n", nome, inicio, fim);
-    for (int i = 0; i <= fim - inicio; i++)
+    long total_size = file1->size + file2->size;
+
+    // Junta os conteúdos brutos
+    if (converter_formato(file1, FORMATO_BRUTO) == -1 || converter_formato(file2, FORMATO_BRUTO) == -1)
+        return -1;
+    descartar_indice(file1);
+    descartar_indice(file2);
+    if (file1->num_extensoes + file2->num_extensoes <= MAX_EXTENSOES)
     {
-        printf("%u ", buffer[i]);
+        // Só metadados: as extensões do segundo arquivo passam a continuar o primeiro
+        memcpy(&file1->extensoes[file1->num_extensoes], file2->extensoes, file2->num_extensoes * sizeof(Extensao));
+        file1->num_extensoes += file2->num_extensoes;
     }
-    printf("\n");
+    else if (concatenar_copiando(file1, file2, total_size) == -1)
+        return -1;
+    file1->size = total_size;
+    marcar_metadados(file1, sizeof(FileEntry));
+
+    // Remove a entrada do segundo arquivo (o resultado fica com o nome do primeiro)
+    remover_entrada(file2);
+    sincronizar_metadados();
 
-    free(buffer);
+    mostrar("Arquivos '%s' e '%s' concatenados em '%s'.\n", nome1, nome2, nome1);
+    return 0;
 }
 
-void concatenar(const char *nome1, const char *nome2)
+/* Desfragmentação: desliza o conteúdo da área de dados para o início, juntando o
+   espaço livre em um trecho só no fim. Os ocupantes (extensões de arquivos, índices
+   esparsos e a tabela do diretório, que fica onde está) são visitados em ordem de
+   posição; cada um que tem espaço livre antes desce até encostar no anterior. Uma
+   extensão maior que a folga (ou que PASSO_DESFRAGMENTACAO) desce em passos: cada
+   passo copia o próximo pedaço para a folga, e a extensão fica dividida em duas (a
+   parte já movida e o resto) até o último passo. As cópias são sequenciais, em
+   pedaços do tamanho do buffer (o maior trecho livre da reserva de huge pages), e
+   cada passo só libera os blocos de origem depois de gravar os metadados que
+   apontam para a cópia: interromper a desfragmentação em qualquer ponto deixa os
+   arquivos íntegros. Um orçamento de tempo e de bytes copiados permite rodá-la aos
+   poucos. */
+#define PASSO_DESFRAGMENTACAO 4096 // Blocos (16 MB) por passo, no máximo
+
+typedef struct
 {
-    int file1_idx = -1, file2_idx = -1;
-    for (int i = 0; i < fs.file_count; i++)
-    {
-        if (strcmp(fs.files[i].name, nome1) == 0)
-            file1_idx = i;
-        if (strcmp(fs.files[i].name, nome2) == 0)
-            file2_idx = i;
-    }
-    if (file1_idx == -1 || file2_idx == -1)
-    {
-        printf("Arquivo(s) não encontrado(s).\n");
-        return;
-    }
+    int start_block;
+    int blocos;
+    FileEntry *arquivo; // Dono (NULL: a tabela do diretório)
+    int extensao;       // Extensão do arquivo, ou -1 para o índice esparso
+} Ocupante;
+
+typedef struct
+{
+    long fim_ns;    // Prazo (0: sem limite de tempo)
+    long restantes; // Bytes que ainda podem ser copiados (-1: sem limite)
+} Orcamento;
 
-    FileEntry *file1 = &fs.files[file1_idx];
-    FileEntry *file2 = &fs.files[file2_idx];
-    int total_size = file1->size + file2->size;
+int comparar_ocupantes(const void *a, const void *b)
+{
+    return ((const Ocupante *)a)->start_block - ((const Ocupante *)b)->start_block;
+}
 
-    // Aloca memória para os dados concatenados
-    void *buffer = malloc(total_size);
-    if (!buffer)
+int orcamento_esgotado(const Orcamento *o)
+{
+    return (o->fim_ns && estat_agora() >= o->fim_ns) || o->restantes == 0;
+}
+
+// Reserva exatamente os blocos [inicio, inicio + n) da área de dados; -1 se não estão livres
+int reservar_blocos_dados_em(int inicio, int n)
+{
+    if (alocador_reservar_em(alocador_dados, inicio, n) == -1)
+        return -1;
+    marcar_blocos(inicio, n, 1);
+    return 0;
+}
+
+// Transfere [pos, pos + len) do disco por inteiro; 0 ou -1
+int transferir_tudo(void *buf, size_t len, off_t pos, int escrita)
+{
+    for (size_t feitos = 0; feitos < len;)
     {
-        perror("Erro ao alocar memória para concatenação");
-        return;
+        ssize_t r = transferir_disco((char *)buf + feitos, len - feitos, pos + feitos, escrita);
+        if (r <= 0)
+            return -1;
+        feitos += r;
     }
+    return 0;
+}
 
-    // Lê dados dos arquivos originais
-    lseek(disk_fd, file1->start_block * BLOCK_SIZE, SEEK_SET);
-    if (read(disk_fd, buffer, file1->size) != file1->size)
+// Copia n blocos de 'origem' para 'destino' (faixas sem sobreposição), em pedaços do buffer
+int copiar_blocos(int origem, int destino, int n, char *buffer, int blocos_buffer, Orcamento *o)
+{
+    for (int feitos = 0; feitos < n;)
     {
-        perror("Erro ao ler primeiro arquivo");
-        free(buffer);
-        return;
+        int k = n - feitos < blocos_buffer ? n - feitos : blocos_buffer;
+        size_t bytes = (size_t)k * BLOCK_SIZE;
+        if (transferir_tudo(buffer, bytes, (off_t)(origem + feitos) * BLOCK_SIZE, 0) == -1 ||
+            transferir_tudo(buffer, bytes, (off_t)(destino + feitos) * BLOCK_SIZE, 1) == -1)
+        {
+            perror("Erro ao mover blocos");
+            return -1;
+        }
+        feitos += k;
+        if (o->restantes > 0)
+            o->restantes = o->restantes > (long)bytes ? o->restantes - (long)bytes : 0;
     }
+    return 0;
+}
 
-    lseek(disk_fd, file2->start_block * BLOCK_SIZE, SEEK_SET);
-    if (read(disk_fd, (uint8_t *)buffer + file1->size, file2->size) != file2->size)
+/* Desce o ocupante 'oc' até 'destino' (tudo entre os dois está livre). Devolve 1 se
+   ele foi até o fim, 0 se não pôde se mover (a tabela do diretório, um índice maior
+   que a folga ou um arquivo sem extensão sobrando para a divisão), 2 se o orçamento
+   acabou no meio e -1 em erro. */
+int deslizar_ocupante(const Ocupante *oc, int destino, char *buffer, int blocos_buffer, Orcamento *o)
+{
+    FileEntry *f = oc->arquivo;
+    int origem = oc->start_block, n = oc->blocos;
+    int passo = origem - destino < PASSO_DESFRAGMENTACAO ? origem - destino : PASSO_DESFRAGMENTACAO;
+    int dividir = passo < n;
+    if (!f || (dividir && (oc->extensao < 0 || f->num_extensoes == MAX_EXTENSOES)))
+        return 0;
+
+    Extensao *x = oc->extensao >= 0 ? &f->extensoes[oc->extensao] : NULL;
+    int64_t bytes = x ? x->bytes : 0;
+    if (dividir)
     {
-        perror("Erro ao ler segundo arquivo");
-        free(buffer);
-        return;
+        // A extensão vira duas: a parte já movida (x[0]) e o resto (x[1])
+        memmove(x + 1, x, (f->num_extensoes - oc->extensao) * sizeof(Extensao));
+        f->num_extensoes++;
     }
 
-    // Aloca espaço para o novo arquivo
-    int blocos_necessarios = (total_size + BLOCK_SIZE - 1) / BLOCK_SIZE;
-    int bloco_inicial = -1;
-    int total_blocks = DISK_SIZE / BLOCK_SIZE;
-
-    // Procura blocos contíguos livres
-    for (int i = 0; i < total_blocks - blocos_necessarios + 1; i++)
+    for (int k = 0; k < n;)
     {
-        int j;
-        for (j = i; j < i + blocos_necessarios; j++)
+        int m = n - k < passo ? n - k : passo;
+        int reservado = reservar_blocos_dados_em(destino + k, m) == 0;
+        if (!reservado || copiar_blocos(origem + k, destino + k, m, buffer, blocos_buffer, o) == -1)
         {
-            if (fs.free_blocks[j] != 0)
-                break;
+            if (reservado)
+                liberar_blocos_dados(destino + k, m);
+            if (dividir && k == 0)
+            {
+                memmove(x, x + 1, (f->num_extensoes - oc->extensao - 1) * sizeof(Extensao));
+                f->num_extensoes--;
+            }
+            return -1;
         }
-        if (j == i + blocos_necessarios)
+        k += m;
+
+        if (!x)
+            f->indice_bloco = destino;
+        else if (!dividir)
+            x->start_block = destino;
+        else
         {
-            bloco_inicial = i;
-            break;
+            long movidos = (long)k * BLOCK_SIZE < bytes ? (long)k * BLOCK_SIZE : bytes;
+            x[0] = (Extensao){destino, movidos};
+            x[1] = (Extensao){origem + k, bytes - movidos};
+            if (k == n)
+            {
+                memmove(x + 1, x + 2, (f->num_extensoes - oc->extensao - 2) * sizeof(Extensao));
+                f->num_extensoes--;
+            }
         }
-    }
+        marcar_metadados(f, sizeof(FileEntry));
+        sincronizar_metadados();
+        liberar_blocos_dados(origem + k - m, m);
 
-    if (bloco_inicial == -1)
-    {
-        printf("Espaço insuficiente para o arquivo concatenado.\n");
-        free(buffer);
-        return;
+        if (k < n && orcamento_esgotado(o))
+            return 2;
     }
+    return 1;
+}
 
-    // Marca os novos blocos como ocupados
-    for (int i = bloco_inicial; i < bloco_inicial + blocos_necessarios; i++)
+// Junta as extensões vizinhas no disco e na ordem do arquivo (a anterior termina em bloco inteiro)
+void juntar_extensoes(FileEntry *f)
+{
+    int antes = f->num_extensoes;
+    for (int e = 0; e + 1 < f->num_extensoes;)
     {
-        fs.free_blocks[i] = 1;
+        Extensao *x = &f->extensoes[e];
+        if (x->bytes % BLOCK_SIZE == 0 && x->start_block + blocos_extensao(x) == x[1].start_block)
+        {
+            x->bytes += x[1].bytes;
+            memmove(x + 1, x + 2, (f->num_extensoes - e - 2) * sizeof(Extensao));
+            f->num_extensoes--;
+        }
+        else
+            e++;
     }
+    if (f->num_extensoes != antes)
+        marcar_metadados(f, sizeof(FileEntry));
+}
 
-    // Escreve os dados concatenados
-    lseek(disk_fd, bloco_inicial * BLOCK_SIZE, SEEK_SET);
-    if (write(disk_fd, buffer, total_size) != total_size)
+// Métrica de fragmentação: do espaço livre (1 - maior trecho / total livre) e dos arquivos
+void exibir_fragmentacao()
+{
+    pthread_mutex_lock(&trava_metadados);
+    long livres = alocador_livres(alocador_dados);
+    int maior = alocador_maior_extensao(alocador_dados);
+    int arquivos = 0, extensoes = 0, divididos = 0;
+    for (uint32_t i = 0; i < fs->sb.capacidade_diretorio; i++)
     {
-        perror("Erro ao escrever arquivo concatenado");
-        free(buffer);
-        return;
+        if (diretorio[i].estado != ENTRADA_USADA)
+            continue;
+        arquivos++;
+        extensoes += diretorio[i].num_extensoes;
+        divididos += diretorio[i].num_extensoes > 1;
     }
+    pthread_mutex_unlock(&trava_metadados);
+    mostrar("Espaço livre: %ld blocos em %d trecho(s), o maior com %d blocos (fragmentação: %.1f%%)\n", livres,
+           alocador_num_extensoes(alocador_dados), maior, livres ? 100.0 * (1.0 - (double)maior / livres) : 0.0);
+    mostrar("Arquivos: %d em %d extensão(ões), %d em mais de uma\n", arquivos, extensoes, divididos);
+}
 
-    free(buffer);
-
-    // Cria a entrada para o arquivo concatenado (reutilizando o nome do primeiro)
-    char nome_concatenado[FILE_NAME_SIZE];
-    strncpy(nome_concatenado, nome1, FILE_NAME_SIZE - 1);
-    nome_concatenado[FILE_NAME_SIZE - 1] = '\0';
+/* Comando desfragmentar: 'limite_ms' e 'limite_mb' limitam o tempo e os megabytes
+   copiados (0: sem limite); a próxima chamada continua de onde esta parou. */
+int desfragmentar(int limite_ms, int limite_mb)
+{
+    Orcamento orcamento = {limite_ms > 0 ? estat_agora() + limite_ms * 1000000L : 0,
+                           limite_mb > 0 ? limite_mb * 1024L * 1024 : -1};
+    mostrar("Antes:\n");
+    exibir_fragmentacao();
 
-    // Libera os blocos dos arquivos originais
-    for (int i = file1->start_block; i < file1->start_block + (file1->size + BLOCK_SIZE - 1) / BLOCK_SIZE; i++)
+    int capacidade = 1;
+    for (uint32_t i = 0; i < fs->sb.capacidade_diretorio; i++)
+        if (diretorio[i].estado == ENTRADA_USADA)
+            capacidade += diretorio[i].num_extensoes + 1;
+    Ocupante *ocupantes = malloc(capacidade * sizeof(Ocupante));
+    if (!ocupantes)
     {
-        fs.free_blocks[i] = 0;
+        perror("Erro ao alocar memória para a desfragmentação");
+        return -1;
     }
-
-    for (int i = file2->start_block; i < file2->start_block + (file2->size + BLOCK_SIZE - 1) / BLOCK_SIZE; i++)
+    int n = 0;
+    ocupantes[n++] = (Ocupante){fs->sb.bloco_diretorio, (int)(bytes_diretorio(fs->sb.capacidade_diretorio) / BLOCK_SIZE),
+                                NULL, 0};
+    for (uint32_t i = 0; i < fs->sb.capacidade_diretorio; i++)
     {
-        fs.free_blocks[i] = 0;
+        FileEntry *f = &diretorio[i];
+        if (f->estado != ENTRADA_USADA)
+            continue;
+        for (int e = 0; e < f->num_extensoes; e++)
+            if (f->extensoes[e].bytes > 0)
+                ocupantes[n++] = (Ocupante){f->extensoes[e].start_block, blocos_extensao(&f->extensoes[e]), f, e};
+        if (f->indice_bloco >= 0)
+            ocupantes[n++] = (Ocupante){f->indice_bloco, blocos_indice(f->indice_entradas), f, -1};
     }
+    qsort(ocupantes, n, sizeof(Ocupante), comparar_ocupantes);
 
-    // Remove as entradas originais do diretório
-    // Remove primeiro o arquivo que vem depois no diretório para evitar deslocamentos incorretos
-    if (file1_idx > file2_idx)
+    // Buffer das cópias: o maior trecho livre da reserva ou, sem ele, um buffer comum
+    size_t bytes_buffer;
+    char *buffer = memoria_alocar_maior(&bytes_buffer);
+    int da_reserva = buffer != NULL;
+    if (!buffer)
     {
-        memmove(&fs.files[file1_idx], &fs.files[file1_idx + 1], (fs.file_count - file1_idx - 1) * sizeof(FileEntry));
-        memmove(&fs.files[file2_idx], &fs.files[file2_idx + 1], (fs.file_count - file2_idx - 1) * sizeof(FileEntry));
-        fs.file_count -= 2;
+        bytes_buffer = BUFFER_COPIA;
+        buffer = memoria_obter(bytes_buffer, BLOCK_SIZE);
     }
-    else
+    if (!buffer)
+    {
+        perror("Erro ao alocar memória para a desfragmentação");
+        free(ocupantes);
+        return -1;
+    }
+
+    struct timespec inicio, fim;
+    clock_gettime(CLOCK_MONOTONIC, &inicio);
+    int movidos = 0, resultado = 0, interrompida = 0;
+    int destino = fs->sb.primeiro_bloco_dados;
+    for (int i = 0; i < n && !interrompida; i++)
     {
-        memmove(&fs.files[file2_idx], &fs.files[file2_idx + 1], (fs.file_count - file2_idx - 1) * sizeof(FileEntry));
-        memmove(&fs.files[file1_idx], &fs.files[file1_idx + 1], (fs.file_count - file1_idx - 1) * sizeof(FileEntry));
-        fs.file_count -= 2;
+        int r = 0;
+        if (ocupantes[i].start_block > destino)
+        {
+            if (orcamento_esgotado(&orcamento))
+            {
+                interrompida = 1;
+                break;
+            }
+            r = deslizar_ocupante(&ocupantes[i], destino, buffer, bytes_buffer / BLOCK_SIZE, &orcamento);
+        }
+        if (r == -1)
+        {
+            resultado = -1;
+            break;
+        }
+        movidos += r > 0;
+        interrompida = r == 2;
+        destino = (r == 1 ? destino : ocupantes[i].start_block) + ocupantes[i].blocos;
     }
+    for (uint32_t i = 0; i < fs->sb.capacidade_diretorio; i++)
+        if (diretorio[i].estado == ENTRADA_USADA)
+            juntar_extensoes(&diretorio[i]);
+    sincronizar_metadados();
 
-    // Adiciona a nova entrada para o arquivo concatenado
-    strncpy(fs.files[fs.file_count].name, nome_concatenado, FILE_NAME_SIZE);
-    fs.files[fs.file_count].size = total_size;
-    fs.files[fs.file_count].start_block = bloco_inicial;
-    fs.file_count++;
+    if (da_reserva)
+        memoria_liberar(buffer);
+    else
+        memoria_devolver(buffer);
+    free(ocupantes);
 
-    printf("Arquivos '%s' e '%s' concatenados em '%s'.\n", nome1, nome2, nome_concatenado);
+    clock_gettime(CLOCK_MONOTONIC, &fim);
+    mostrar("Desfragmentação: %d trecho(s) movido(s) em %.2f ms%s\n", movidos,
+           (fim.tv_sec - inicio.tv_sec) * 1000.0 + (fim.tv_nsec - inicio.tv_nsec) / 1e6,
+           interrompida ? " (parou no limite; rode de novo para continuar)" : "");
+    mostrar("Depois:\n");
+    exibir_fragmentacao();
+    return resultado;
 }
 
 // Inicializa o sistema de arquivos
@@ -570,25 +4050,59 @@ void sistema_arquivos()
         exit(EXIT_FAILURE);
     }
 
-    // Verificação inicial de Huge Page
-    void *test_page = alocar_huge_page();
-    if (!test_page)
+    // Reserva as huge pages uma vez só; ordenações e buffers de E/S saem dela
+    if (memoria_iniciar(PAGINAS_RESERVA_PADRAO) == -1)
     {
         verificar_config_hugepage();
         close(disk_fd);
         exit(EXIT_FAILURE);
     }
-    liberar_huge_page(test_page);
 
-    // Verificar tamanho do disco
-    if (lseek(disk_fd, DISK_SIZE - 1, SEEK_SET) == -1)
+    /* Monta os metadados direto do disco, com a geometria gravada no superbloco. Só
+       uma imagem vazia (nova) é formatada aqui: uma que não se reconhece (de outra
+       versão, corrompida ou ilegível) fica intacta e sem montar, à espera de formatar. */
+    Superbloco sb;
+    struct stat st;
+    if (pread(disk_fd, &sb, sizeof(sb), 0) == (ssize_t)sizeof(sb) && superbloco_valido(&sb))
     {
-        perror("Erro ao configurar disco");
-        close(disk_fd);
-        exit(EXIT_FAILURE);
+        if (mapear_metadados(sb.disk_size) == -1)
+        {
+            perror("Erro ao mapear metadados do disco");
+            close(disk_fd);
+            exit(EXIT_FAILURE);
+        }
+        diretorio = mapear_diretorio(fs->sb.bloco_diretorio, fs->sb.capacidade_diretorio);
+        if (!diretorio)
+        {
+            perror("Erro ao mapear o diretório");
+            close(disk_fd);
+            exit(EXIT_FAILURE);
+        }
+        diretorio_sujo = calloc(bytes_diretorio(fs->sb.capacidade_diretorio) / BLOCK_SIZE, 1);
+        montar_alocadores();
+        mostrar("Sistema de arquivos montado: %d arquivo(s).\n", fs->file_count);
+    }
+    else if (fstat(disk_fd, &st) == -1 || st.st_size > 0)
+        mostrar("A imagem disco_virtual.img não tem um superbloco válido (outra versão ou dados corrompidos) "
+                "e não foi montada nem alterada. Para apagá-la e recriar o disco, use formatar <MB> <MB de swap>.\n");
+    else
+    {
+        if (initialize_filesystem(disk_size_formatacao, swap_size_formatacao) == -1)
+        {
+            perror("Erro ao formatar o disco");
+            close(disk_fd);
+            exit(EXIT_FAILURE);
+        }
+        mostrar("Disco virtual formatado: %ld MB, dos quais %ld MB de swap.\n",
+               (long)(disk_size_formatacao / (1024 * 1024)), (long)(swap_size_formatacao / (1024 * 1024)));
     }
-    write(disk_fd, "", 1);
 
-    initialize_filesystem();
-    printf("Sistema inicializado. Huge Page configurada com sucesso.\n");
+    // Os dados são lidos e gravados em sequência, em pedaços grandes
+    posix_fadvise(disk_fd, 0, 0, POSIX_FADV_SEQUENTIAL);
+
+    // Os pedidos pequenos passam pelo cache de blocos (sem ele, tudo vai direto ao disco)
+    cache_configurar(disk_fd, CACHE_QUADROS_PADRAO);
+
+    es_iniciar();
+    mostrar("Sistema inicializado. Huge Page configurada com sucesso.\n");
 }
\ No newline at end of file
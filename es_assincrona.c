@@ -0,0 +1,375 @@
+#define _GNU_SOURCE // Deve vir antes de qualquer include
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <pthread.h>
+#include <unistd.h>
+#include <sys/types.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+
+/* Camada de E/S assíncrona usada pela ordenação externa.
+   Cada pedido (leitura ou escrita em um offset absoluto) devolve um ticket; o chamador
+   segue trabalhando e depois chama es_aguardar(ticket). Há dois backends:
+   - io_uring, via syscalls diretas (sem liburing), quando o kernel permite;
+   - uma thread auxiliar que executa os pedidos em ordem com pread/pwrite.
+   Compile com -DSEM_IO_URING para forçar o segundo. */
+
+#if defined(__NR_io_uring_setup) && !defined(SEM_IO_URING)
+#include <linux/io_uring.h>
+#define USAR_IO_URING 1
+#endif
+
+#define ES_MAX_PENDENTES 512
+#define ES_CONCLUIDO (-2) // Ticket de um pedido já executado de forma síncrona
+#define ES_FALHOU (-3)    // Ticket de um pedido síncrono que não transferiu tudo
+
+enum
+{
+    SLOT_LIVRE,
+    SLOT_PENDENTE,
+    SLOT_CONCLUIDO
+};
+
+typedef struct
+{
+    int estado;
+    int escrita;
+    int fd;
+    char *buf;
+    size_t len;
+    off_t off;
+    size_t feitos;     // Bytes já transferidos (pedidos parciais são reenviados)
+    ssize_t resultado; // Bytes transferidos ou -1
+    long inicio_ns;    // Momento do envio, para a latência
+} PedidoES;
+
+PedidoES es_slots[ES_MAX_PENDENTES];
+int es_usar_thread = 0;
+int es_iniciada = 0;
+
+// Declarações externas dos contadores de desempenho (implementados em estatisticas.c)
+extern long estat_agora();
+extern void estat_es(int escrita, size_t bytes, long ns);
+
+// Executa um pedido por completo com pread/pwrite
+ssize_t es_executar(PedidoES *p)
+{
+    while (p->feitos < p->len)
+    {
+        ssize_t n = p->escrita
+                        ? pwrite(p->fd, p->buf + p->feitos, p->len - p->feitos, p->off + p->feitos)
+                        : pread(p->fd, p->buf + p->feitos, p->len - p->feitos, p->off + p->feitos);
+        if (n < 0 && errno == EINTR)
+            continue;
+        if (n < 0)
+        {
+            perror(p->escrita ? "Erro na escrita assíncrona" : "Erro na leitura assíncrona");
+            return -1;
+        }
+        if (n == 0)
+            break; // Fim do arquivo
+        p->feitos += n;
+    }
+    return p->feitos;
+}
+
+/* ---------- Backend: thread auxiliar ---------- */
+
+pthread_t es_thread;
+pthread_mutex_t es_mutex = PTHREAD_MUTEX_INITIALIZER;
+pthread_cond_t es_cond_pedido = PTHREAD_COND_INITIALIZER;
+pthread_cond_t es_cond_concluido = PTHREAD_COND_INITIALIZER;
+int es_fila[ES_MAX_PENDENTES];
+int es_fila_inicio = 0, es_fila_tamanho = 0;
+int es_colhendo = 0; // io_uring: 1 enquanto alguma thread espera conclusões do kernel
+
+// Executa a fila até o fim do processo
+void *es_trabalhador(void *arg)
+{
+    (void)arg;
+    pthread_mutex_lock(&es_mutex);
+    while (1)
+    {
+        while (es_fila_tamanho == 0)
+            pthread_cond_wait(&es_cond_pedido, &es_mutex);
+
+        PedidoES *p = &es_slots[es_fila[es_fila_inicio]];
+        es_fila_inicio = (es_fila_inicio + 1) % ES_MAX_PENDENTES;
+        es_fila_tamanho--;
+
+        pthread_mutex_unlock(&es_mutex);
+        ssize_t r = es_executar(p);
+        pthread_mutex_lock(&es_mutex);
+
+        p->resultado = r;
+        p->estado = SLOT_CONCLUIDO;
+        pthread_cond_broadcast(&es_cond_concluido);
+    }
+    return NULL;
+}
+
+/* ---------- Backend: io_uring ---------- */
+
+#ifdef USAR_IO_URING
+typedef struct
+{
+    int fd;
+    unsigned *sq_head, *sq_tail, *sq_mask, *sq_array;
+    unsigned *cq_head, *cq_tail, *cq_mask;
+    struct io_uring_sqe *sqes;
+    struct io_uring_cqe *cqes;
+    void *sq_ptr, *cq_ptr;
+    size_t sq_len, cq_len, sqes_len;
+} AnelES;
+
+AnelES anel;
+
+int anel_iniciar()
+{
+    struct io_uring_params params;
+    memset(&params, 0, sizeof(params));
+    anel.fd = syscall(__NR_io_uring_setup, ES_MAX_PENDENTES, &params);
+    if (anel.fd < 0)
+        return -1;
+
+    anel.sq_len = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+    anel.cq_len = params.cq_off.cqes + params.cq_entries * sizeof(struct io_uring_cqe);
+    if (params.features & IORING_FEAT_SINGLE_MMAP)
+    {
+        if (anel.cq_len > anel.sq_len)
+            anel.sq_len = anel.cq_len;
+        anel.cq_len = anel.sq_len;
+    }
+
+    anel.sq_ptr = mmap(NULL, anel.sq_len, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+                       anel.fd, IORING_OFF_SQ_RING);
+    if (anel.sq_ptr == MAP_FAILED)
+    {
+        close(anel.fd);
+        return -1;
+    }
+    if (params.features & IORING_FEAT_SINGLE_MMAP)
+        anel.cq_ptr = anel.sq_ptr;
+    else
+    {
+        anel.cq_ptr = mmap(NULL, anel.cq_len, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+                           anel.fd, IORING_OFF_CQ_RING);
+        if (anel.cq_ptr == MAP_FAILED)
+        {
+            munmap(anel.sq_ptr, anel.sq_len);
+            close(anel.fd);
+            return -1;
+        }
+    }
+
+    anel.sqes_len = params.sq_entries * sizeof(struct io_uring_sqe);
+    anel.sqes = mmap(NULL, anel.sqes_len, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+                     anel.fd, IORING_OFF_SQES);
+    if (anel.sqes == MAP_FAILED)
+    {
+        if (anel.cq_ptr != anel.sq_ptr)
+            munmap(anel.cq_ptr, anel.cq_len);
+        munmap(anel.sq_ptr, anel.sq_len);
+        close(anel.fd);
+        return -1;
+    }
+
+    char *sq = anel.sq_ptr, *cq = anel.cq_ptr;
+    anel.sq_head = (unsigned *)(sq + params.sq_off.head);
+    anel.sq_tail = (unsigned *)(sq + params.sq_off.tail);
+    anel.sq_mask = (unsigned *)(sq + params.sq_off.ring_mask);
+    anel.sq_array = (unsigned *)(sq + params.sq_off.array);
+    anel.cq_head = (unsigned *)(cq + params.cq_off.head);
+    anel.cq_tail = (unsigned *)(cq + params.cq_off.tail);
+    anel.cq_mask = (unsigned *)(cq + params.cq_off.ring_mask);
+    anel.cqes = (struct io_uring_cqe *)(cq + params.cq_off.cqes);
+    return 0;
+}
+
+// Coloca o restante do pedido 'slot' na fila de submissão e avisa o kernel
+int anel_submeter(int slot)
+{
+    PedidoES *p = &es_slots[slot];
+    unsigned tail = *anel.sq_tail;
+    unsigned idx = tail & *anel.sq_mask;
+    struct io_uring_sqe *sqe = &anel.sqes[idx];
+
+    memset(sqe, 0, sizeof(*sqe));
+    sqe->opcode = p->escrita ? IORING_OP_WRITE : IORING_OP_READ;
+    sqe->fd = p->fd;
+    sqe->addr = (unsigned long)(p->buf + p->feitos);
+    sqe->len = p->len - p->feitos;
+    sqe->off = p->off + p->feitos;
+    sqe->user_data = slot;
+    anel.sq_array[idx] = idx;
+    __atomic_store_n(anel.sq_tail, tail + 1, __ATOMIC_RELEASE);
+
+    return syscall(__NR_io_uring_enter, anel.fd, 1, 0, 0, NULL, 0) < 0 ? -1 : 0;
+}
+
+/* Bloqueia até haver ao menos uma conclusão na fila, sem consumi-la. Roda sem
+   es_mutex: só a thread que colhe (es_colhendo) mexe na cabeça da fila. */
+void anel_esperar()
+{
+    if (*anel.cq_head == __atomic_load_n(anel.cq_tail, __ATOMIC_ACQUIRE))
+        syscall(__NR_io_uring_enter, anel.fd, 0, 1, IORING_ENTER_GETEVENTS, NULL, 0);
+}
+
+// Consome as conclusões disponíveis (com es_mutex)
+void anel_colher()
+{
+    unsigned head = *anel.cq_head;
+    unsigned tail = __atomic_load_n(anel.cq_tail, __ATOMIC_ACQUIRE);
+    for (; head != tail; head++)
+    {
+        struct io_uring_cqe *cqe = &anel.cqes[head & *anel.cq_mask];
+        PedidoES *p = &es_slots[cqe->user_data];
+        if (cqe->res < 0)
+        {
+            errno = -cqe->res;
+            perror(p->escrita ? "Erro na escrita assíncrona" : "Erro na leitura assíncrona");
+            p->resultado = -1;
+            p->estado = SLOT_CONCLUIDO;
+            continue;
+        }
+        p->feitos += cqe->res;
+        if (cqe->res > 0 && p->feitos < p->len)
+        {
+            // Transferência parcial: reenvia o restante
+            if (anel_submeter(cqe->user_data) == 0)
+                continue;
+            p->resultado = es_executar(p);
+        }
+        else
+            p->resultado = p->feitos;
+        p->estado = SLOT_CONCLUIDO;
+    }
+    __atomic_store_n(anel.cq_head, head, __ATOMIC_RELEASE);
+}
+#endif
+
+/* ---------- Interface pública ---------- */
+
+void es_iniciar()
+{
+    if (es_iniciada)
+        return;
+    es_iniciada = 1;
+
+#ifdef USAR_IO_URING
+    if (anel_iniciar() == 0)
+        return;
+#endif
+    es_usar_thread = 1;
+    if (pthread_create(&es_thread, NULL, es_trabalhador, NULL) != 0)
+    {
+        perror("Erro ao criar thread de E/S");
+        es_usar_thread = 0; // Sem thread: os pedidos passam a ser síncronos
+    }
+}
+
+int es_enviar(int fd, void *buf, size_t len, off_t off, int escrita)
+{
+    long inicio_ns = estat_agora();
+    pthread_mutex_lock(&es_mutex);
+    int slot = -1;
+    for (int i = 0; i < ES_MAX_PENDENTES; i++)
+    {
+        if (es_slots[i].estado == SLOT_LIVRE)
+        {
+            slot = i;
+            break;
+        }
+    }
+    if (slot == -1)
+    {
+        // Sem slots livres: executa na hora
+        pthread_mutex_unlock(&es_mutex);
+        PedidoES p = {SLOT_PENDENTE, escrita, fd, buf, len, off, 0, 0, inicio_ns};
+        ssize_t r = es_executar(&p);
+        estat_es(escrita, r > 0 ? r : 0, estat_agora() - inicio_ns);
+        return r == (ssize_t)len ? ES_CONCLUIDO : ES_FALHOU;
+    }
+
+    es_slots[slot] = (PedidoES){SLOT_PENDENTE, escrita, fd, buf, len, off, 0, 0, inicio_ns};
+#ifdef USAR_IO_URING
+    if (!es_usar_thread)
+    {
+        if (anel_submeter(slot) < 0)
+        {
+            es_slots[slot].resultado = es_executar(&es_slots[slot]);
+            es_slots[slot].estado = SLOT_CONCLUIDO;
+        }
+        pthread_mutex_unlock(&es_mutex);
+        return slot;
+    }
+#endif
+    if (!es_iniciada || !es_usar_thread)
+    {
+        es_slots[slot].resultado = es_executar(&es_slots[slot]);
+        es_slots[slot].estado = SLOT_CONCLUIDO;
+    }
+    else
+    {
+        es_fila[(es_fila_inicio + es_fila_tamanho) % ES_MAX_PENDENTES] = slot;
+        es_fila_tamanho++;
+        pthread_cond_signal(&es_cond_pedido);
+    }
+    pthread_mutex_unlock(&es_mutex);
+    return slot;
+}
+
+// Agenda a leitura de 'len' bytes do offset 'off' para 'buf'; devolve o ticket
+int es_ler(int fd, void *buf, size_t len, off_t off)
+{
+    return es_enviar(fd, buf, len, off, 0);
+}
+
+// Agenda a escrita de 'len' bytes de 'buf' no offset 'off'; devolve o ticket
+int es_escrever(int fd, const void *buf, size_t len, off_t off)
+{
+    return es_enviar(fd, (void *)buf, len, off, 1);
+}
+
+/* Espera o pedido terminar e libera o ticket; devolve os bytes transferidos ou -1.
+   Um pedido já executado na hora devolve 0 se deu certo. */
+ssize_t es_aguardar(int ticket)
+{
+    if (ticket == ES_FALHOU)
+        return -1;
+    if (ticket < 0)
+        return 0;
+
+    pthread_mutex_lock(&es_mutex);
+    PedidoES *p = &es_slots[ticket];
+    while (p->estado != SLOT_CONCLUIDO)
+    {
+#ifdef USAR_IO_URING
+        /* Uma thread por vez colhe: ela espera o kernel sem a trava (as outras seguem
+           enviando pedidos) e depois acorda as que esperam, como a thread auxiliar */
+        if (!es_usar_thread && !es_colhendo)
+        {
+            es_colhendo = 1;
+            pthread_mutex_unlock(&es_mutex);
+            anel_esperar();
+            pthread_mutex_lock(&es_mutex);
+            anel_colher();
+            es_colhendo = 0;
+            pthread_cond_broadcast(&es_cond_concluido);
+            continue;
+        }
+#endif
+        pthread_cond_wait(&es_cond_concluido, &es_mutex);
+    }
+    ssize_t r = p->resultado;
+    int escrita = p->escrita;
+    long inicio_ns = p->inicio_ns;
+    p->estado = SLOT_LIVRE;
+    pthread_mutex_unlock(&es_mutex);
+
+    // Latência do envio até a espera terminar (inclui o tempo que o pedido ficou pronto)
+    estat_es(escrita, r > 0 ? r : 0, estat_agora() - inicio_ns);
+    return r;
+}
\ No newline at end of file
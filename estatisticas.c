@@ -0,0 +1,339 @@
+#define _GNU_SOURCE // Deve vir antes de qualquer include
+#include <pthread.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+
+/* Contadores de desempenho.
+   Cada evento (pedido de E/S, msync, alocação de swap ou de huge page, intercalação,
+   faltas de página, procura no cache de blocos) soma em dois conjuntos de contadores:
+   o acumulado desde o início do programa e o da operação corrente. Cada thread que
+   executa comandos tem o seu conjunto da operação, zerado a cada comando (no servidor,
+   os comandos de várias conexões correm juntos sem misturar as contagens); as threads
+   da ordenação somam no conjunto da thread que as criou. As somas são atômicas e
+   relaxadas, então ninguém trava nada para registrar. As latências vão para
+   histogramas com baldes em potências de 2 de nanossegundos. */
+
+// Declarações externas da saída dos comandos (implementada em servidor.c)
+extern FILE *saida_atual();
+extern void mostrar(const char *formato, ...);
+
+#define HIST_BALDES 40 // Balde i: latências em [2^i, 2^(i+1)) ns
+
+typedef struct
+{
+    long contagem;
+    long soma_ns;
+    long max_ns;
+    long baldes[HIST_BALDES];
+} Histograma;
+
+typedef struct
+{
+    long leituras, escritas; // Pedidos ao disco
+    long bytes_lidos, bytes_escritos;
+    long msyncs;
+    long blocos_swap_alocados, blocos_swap_liberados, falhas_swap;
+    long runs_geradas, passadas_intercalacao, intercalacoes, elementos_intercalados;
+    long huge_pages, falhas_huge_page;
+    long faltas_pagina, despejos_pagina, gravacoes_pagina;
+    long cache_acertos, cache_faltas, cache_despejos, cache_despejos_sujos;
+    Histograma lat_leitura, lat_escrita, lat_msync, lat_huge_page, lat_intercalacao;
+} Estatisticas;
+
+Estatisticas estat_acumulado;
+__thread Estatisticas estat_da_thread;      // Operação corrente desta thread
+__thread Estatisticas *estat_operacao_atual; // Onde esta thread soma a operação (NULL: em nenhuma)
+__thread char estat_nome_thread[64];
+
+// Cópia da última operação concluída, para o comando estatisticas
+Estatisticas estat_ultima;
+char estat_operacao[64] = "nenhuma";
+pthread_mutex_t estat_trava_ultima = PTHREAD_MUTEX_INITIALIZER;
+
+long estat_agora()
+{
+    struct timespec t;
+    clock_gettime(CLOCK_MONOTONIC, &t);
+    return t.tv_sec * 1000000000L + t.tv_nsec;
+}
+
+void somar(long *contador, long valor)
+{
+    __atomic_fetch_add(contador, valor, __ATOMIC_RELAXED);
+}
+
+void registrar_latencia(Histograma *h, long ns)
+{
+    if (ns < 0)
+        return;
+    int balde = 0;
+    while (balde < HIST_BALDES - 1 && (1L << (balde + 1)) <= ns)
+        balde++;
+    somar(&h->contagem, 1);
+    somar(&h->soma_ns, ns);
+    somar(&h->baldes[balde], 1);
+    long max = __atomic_load_n(&h->max_ns, __ATOMIC_RELAXED);
+    while (ns > max && !__atomic_compare_exchange_n(&h->max_ns, &max, ns, 1, __ATOMIC_RELAXED, __ATOMIC_RELAXED))
+        ;
+}
+
+// Conjuntos que um evento atualiza: o acumulado e, se houver, o da operação desta thread
+int alvos(Estatisticas *e[2])
+{
+    e[0] = &estat_acumulado;
+    e[1] = estat_operacao_atual;
+    return e[1] ? 2 : 1;
+}
+
+// Zera os contadores da operação corrente desta thread (os acumulados seguem)
+void estat_iniciar_operacao(const char *nome)
+{
+    memset(&estat_da_thread, 0, sizeof(Estatisticas));
+    estat_operacao_atual = &estat_da_thread;
+    snprintf(estat_nome_thread, sizeof(estat_nome_thread), "%s", nome);
+    for (char *c = estat_nome_thread; *c; c++)
+        if (*c == '"' || *c == '\\' || (unsigned char)*c < 0x20)
+            *c = '_'; // O nome vai para o JSON sem escapes
+}
+
+// Guarda a operação desta thread como a última (a que o comando estatisticas mostra)
+void estat_terminar_operacao()
+{
+    if (!estat_operacao_atual)
+        return;
+    pthread_mutex_lock(&estat_trava_ultima);
+    estat_ultima = estat_da_thread;
+    memcpy(estat_operacao, estat_nome_thread, sizeof(estat_operacao));
+    pthread_mutex_unlock(&estat_trava_ultima);
+    estat_operacao_atual = NULL;
+}
+
+// Para as threads da ordenação: somam na operação da thread que as criou
+void *estat_operacao_corrente()
+{
+    return estat_operacao_atual;
+}
+
+void estat_adotar_operacao(void *operacao)
+{
+    estat_operacao_atual = operacao;
+}
+
+// Um pedido de leitura ou escrita de 'bytes' no disco; 'ns' < 0 se não foi medido
+void estat_es(int escrita, size_t bytes, long ns)
+{
+    Estatisticas *e[2];
+    for (int i = 0, n = alvos(e); i < n; i++)
+    {
+        somar(escrita ? &e[i]->escritas : &e[i]->leituras, 1);
+        somar(escrita ? &e[i]->bytes_escritos : &e[i]->bytes_lidos, bytes);
+        registrar_latencia(escrita ? &e[i]->lat_escrita : &e[i]->lat_leitura, ns);
+    }
+}
+
+void estat_msync(size_t bytes, long ns)
+{
+    Estatisticas *e[2];
+    for (int i = 0, n = alvos(e); i < n; i++)
+    {
+        somar(&e[i]->msyncs, 1);
+        somar(&e[i]->bytes_escritos, bytes);
+        registrar_latencia(&e[i]->lat_msync, ns);
+    }
+}
+
+// 'resultado': 1 = blocos alocados, 0 = liberados, -1 = alocação falhou
+void estat_swap(int blocos, int resultado)
+{
+    Estatisticas *e[2];
+    for (int i = 0, n = alvos(e); i < n; i++)
+    {
+        if (resultado == 1)
+            somar(&e[i]->blocos_swap_alocados, blocos);
+        else if (resultado == 0)
+            somar(&e[i]->blocos_swap_liberados, blocos);
+        else
+            somar(&e[i]->falhas_swap, 1);
+    }
+}
+
+void estat_huge_page(int sucesso, long ns)
+{
+    Estatisticas *e[2];
+    for (int i = 0, n = alvos(e); i < n; i++)
+    {
+        somar(sucesso ? &e[i]->huge_pages : &e[i]->falhas_huge_page, 1);
+        registrar_latencia(&e[i]->lat_huge_page, ns);
+    }
+}
+
+void estat_runs(int runs)
+{
+    Estatisticas *e[2];
+    for (int i = 0, n = alvos(e); i < n; i++)
+        somar(&e[i]->runs_geradas, runs);
+}
+
+void estat_passada()
+{
+    Estatisticas *e[2];
+    for (int i = 0, n = alvos(e); i < n; i++)
+        somar(&e[i]->passadas_intercalacao, 1);
+}
+
+// Uma intercalação k-way de 'elementos' elementos que levou 'ns'
+void estat_intercalacao(long elementos, long ns)
+{
+    Estatisticas *e[2];
+    for (int i = 0, n = alvos(e); i < n; i++)
+    {
+        somar(&e[i]->intercalacoes, 1);
+        somar(&e[i]->elementos_intercalados, elementos);
+        registrar_latencia(&e[i]->lat_intercalacao, ns);
+    }
+}
+
+void estat_paginacao(long faltas, long despejos, long gravacoes)
+{
+    Estatisticas *e[2];
+    for (int i = 0, n = alvos(e); i < n; i++)
+    {
+        somar(&e[i]->faltas_pagina, faltas);
+        somar(&e[i]->despejos_pagina, despejos);
+        somar(&e[i]->gravacoes_pagina, gravacoes);
+    }
+}
+
+// Uma procura no cache de blocos
+void estat_cache(int acerto)
+{
+    Estatisticas *e[2];
+    for (int i = 0, n = alvos(e); i < n; i++)
+        somar(acerto ? &e[i]->cache_acertos : &e[i]->cache_faltas, 1);
+}
+
+// Um quadro do cache reusado; 'sujo' se o bloco teve de ser gravado antes
+void estat_cache_despejo(int sujo)
+{
+    Estatisticas *e[2];
+    for (int i = 0, n = alvos(e); i < n; i++)
+    {
+        somar(&e[i]->cache_despejos, 1);
+        if (sujo)
+            somar(&e[i]->cache_despejos_sujos, 1);
+    }
+}
+
+// Bytes lidos e gravados no disco pela operação corrente desta thread
+void estat_bytes_operacao(long *lidos, long *escritos)
+{
+    *lidos = *escritos = 0;
+    if (!estat_operacao_atual)
+        return;
+    *lidos = __atomic_load_n(&estat_operacao_atual->bytes_lidos, __ATOMIC_RELAXED);
+    *escritos = __atomic_load_n(&estat_operacao_atual->bytes_escritos, __ATOMIC_RELAXED);
+}
+
+// Limite superior (em µs) do balde onde a fração 'q' das amostras é alcançada
+double percentil_us(const Histograma *h, double q)
+{
+    long alvo = (long)(q * h->contagem + 0.5), vistos = 0;
+    for (int b = 0; b < HIST_BALDES; b++)
+    {
+        vistos += h->baldes[b];
+        if (vistos >= alvo && vistos > 0)
+            return (double)(1L << (b + 1)) / 1000.0;
+    }
+    return 0.0;
+}
+
+void exibir_latencia(FILE *f, const char *nome, const Histograma *h, int json)
+{
+    double media = h->contagem ? (double)h->soma_ns / h->contagem / 1000.0 : 0.0;
+    if (!json)
+    {
+        if (h->contagem)
+            fprintf(f, "  %-14s n=%ld média=%.1f µs p50<=%.1f µs p99<=%.1f µs máx=%.1f µs\n", nome, h->contagem,
+                    media, percentil_us(h, 0.50), percentil_us(h, 0.99), h->max_ns / 1000.0);
+        return;
+    }
+    fprintf(f, "\"%s\":{\"n\":%ld,\"media_us\":%.3f,\"p50_us\":%.3f,\"p99_us\":%.3f,\"max_us\":%.3f,\"baldes_ns_log2\":[",
+            nome, h->contagem, media, percentil_us(h, 0.50), percentil_us(h, 0.99), h->max_ns / 1000.0);
+    for (int b = 0; b < HIST_BALDES; b++)
+        fprintf(f, "%s%ld", b ? "," : "", h->baldes[b]);
+    fprintf(f, "]}");
+}
+
+void exibir_conjunto(FILE *f, const Estatisticas *e, int json)
+{
+    const char *nomes[] = {"leituras", "escritas", "bytes_lidos", "bytes_escritos", "msyncs",
+                           "blocos_swap_alocados", "blocos_swap_liberados", "falhas_swap",
+                           "runs_geradas", "passadas_intercalacao", "intercalacoes", "elementos_intercalados",
+                           "huge_pages", "falhas_huge_page", "faltas_pagina", "despejos_pagina", "gravacoes_pagina",
+                           "cache_acertos", "cache_faltas", "cache_despejos", "cache_despejos_sujos"};
+    const long valores[] = {e->leituras, e->escritas, e->bytes_lidos, e->bytes_escritos, e->msyncs,
+                            e->blocos_swap_alocados, e->blocos_swap_liberados, e->falhas_swap,
+                            e->runs_geradas, e->passadas_intercalacao, e->intercalacoes, e->elementos_intercalados,
+                            e->huge_pages, e->falhas_huge_page, e->faltas_pagina, e->despejos_pagina, e->gravacoes_pagina,
+                            e->cache_acertos, e->cache_faltas, e->cache_despejos, e->cache_despejos_sujos};
+    const char *latencias[] = {"leitura", "escrita", "msync", "huge_page", "intercalacao"};
+    const Histograma *histogramas[] = {&e->lat_leitura, &e->lat_escrita, &e->lat_msync, &e->lat_huge_page,
+                                       &e->lat_intercalacao};
+
+    for (int i = 0; i < (int)(sizeof(valores) / sizeof(valores[0])); i++)
+    {
+        if (json)
+            fprintf(f, "\"%s\":%ld,", nomes[i], valores[i]);
+        else if (valores[i])
+            fprintf(f, "  %-22s %ld\n", nomes[i], valores[i]);
+    }
+    if (json)
+        fprintf(f, "\"latencias\":{");
+    else
+        fprintf(f, "  Latências:\n");
+    for (int i = 0; i < 5; i++)
+    {
+        if (json && i)
+            fprintf(f, ",");
+        exibir_latencia(f, latencias[i], histogramas[i], json);
+    }
+    if (json)
+        fprintf(f, "}");
+}
+
+/* Comando estatisticas: sem arquivo, mostra os contadores acumulados e os da última
+   operação; com arquivo, grava os dois em JSON nele. */
+int estatisticas(const char *arquivo)
+{
+    Estatisticas ultima;
+    char nome[sizeof(estat_operacao)];
+    pthread_mutex_lock(&estat_trava_ultima);
+    ultima = estat_ultima;
+    memcpy(nome, estat_operacao, sizeof(nome));
+    pthread_mutex_unlock(&estat_trava_ultima);
+
+    if (!arquivo)
+    {
+        mostrar("Estatísticas acumuladas:\n");
+        exibir_conjunto(saida_atual(), &estat_acumulado, 0);
+        mostrar("Estatísticas da última operação (%s):\n", nome);
+        exibir_conjunto(saida_atual(), &ultima, 0);
+        return 0;
+    }
+
+    FILE *f = fopen(arquivo, "w");
+    if (!f)
+    {
+        perror("Erro ao criar arquivo de estatísticas");
+        return -1;
+    }
+    fprintf(f, "{\"acumulado\":{");
+    exibir_conjunto(f, &estat_acumulado, 1);
+    fprintf(f, "},\"operacao\":{\"nome\":\"%s\",", nome);
+    exibir_conjunto(f, &ultima, 1);
+    fprintf(f, "}}\n");
+    fclose(f);
+    mostrar("Estatísticas gravadas em '%s'.\n", arquivo);
+    return 0;
+}
\ No newline at end of file
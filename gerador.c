@@ -0,0 +1,58 @@
+#include <stdint.h>
+#include <stddef.h>
+
+/* Gerador de números pseudoaleatórios para criar arquivos em massa.
+   Usa o xoshiro128++ com GERADOR_VIAS estados independentes guardados lado a lado
+   (um vetor por palavra de estado): cada passo avança todas as vias juntas, em um
+   laço sem dependência entre elas que o compilador consegue vetorizar. Um fluxo é
+   identificado por (semente, fluxo) e semeado pelo splitmix64, então o mesmo par
+   gera sempre a mesma sequência, e fluxos diferentes podem ser gerados em paralelo. */
+
+#define GERADOR_VIAS 8
+
+uint64_t splitmix64(uint64_t *x)
+{
+    uint64_t z = (*x += 0x9E3779B97F4A7C15ULL);
+    z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+    z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+    return z ^ (z >> 31);
+}
+
+uint32_t rotacionar32(uint32_t x, int k)
+{
+    return (x << k) | (x >> (32 - k));
+}
+
+// Preenche v[0..n) com o início da sequência do fluxo 'fluxo' da semente 'semente'
+void gerador_preencher(uint32_t *v, size_t n, uint64_t semente, uint64_t fluxo)
+{
+    uint32_t s0[GERADOR_VIAS], s1[GERADOR_VIAS], s2[GERADOR_VIAS], s3[GERADOR_VIAS];
+    uint64_t x = semente ^ (fluxo * 0xD1B54A32D192ED03ULL);
+    for (int l = 0; l < GERADOR_VIAS; l++)
+    {
+        uint64_t a = splitmix64(&x), b = splitmix64(&x);
+        s0[l] = (uint32_t)a;
+        s1[l] = (uint32_t)(a >> 32);
+        s2[l] = (uint32_t)b;
+        s3[l] = (uint32_t)(b >> 32) | 1; // O estado nunca pode ser todo zero
+    }
+
+    uint32_t saida[GERADOR_VIAS];
+    for (size_t i = 0; i < n; i += GERADOR_VIAS)
+    {
+        for (int l = 0; l < GERADOR_VIAS; l++)
+        {
+            saida[l] = rotacionar32(s0[l] + s3[l], 7) + s0[l];
+            uint32_t t = s1[l] << 9;
+            s2[l] ^= s0[l];
+            s3[l] ^= s1[l];
+            s1[l] ^= s2[l];
+            s0[l] ^= s3[l];
+            s2[l] ^= t;
+            s3[l] = rotacionar32(s3[l], 11);
+        }
+        size_t resto = n - i < GERADOR_VIAS ? n - i : GERADOR_VIAS;
+        for (size_t l = 0; l < resto; l++)
+            v[i + l] = saida[l];
+    }
+}
\ No newline at end of file
@@ -1,22 +1,359 @@
+#define _GNU_SOURCE // Deve vir antes de qualquer include
 #include <stdio.h>
+#include <stdlib.h>
+#include <errno.h>
+#include <limits.h>
 #include <stdbool.h>
+#include <string.h>
+#include <stdint.h>
+#include <time.h>
+#include <unistd.h>
 
 // Declarações das funções
 void sistema_arquivos();
 void gerenciamento_memoria();
-void criar(const char *nome, int tam);
-void apagar(const char *nome);
-void listar();
-void ordenar(const char *nome);
-void ler(const char *nome, int inicio, int fim);
-void concatenar(const char *nome1, const char *nome2);
-
-int main()
+int criar(const char *nome, long tam);
+int apagar(const char *nome);
+int listar();
+int ordenar(const char *nome);
+int ler(const char *nome, long inicio, long fim);
+int concatenar(const char *nome1, const char *nome2);
+int buscar(const char *nome, int minimo, int maximo);
+int extremos(const char *nome, long k, int maiores);
+int quantis(const char *nome, const double *q, int num_quantis, int aproximado);
+int histograma(const char *nome, int num_baldes, int com_faixa, int32_t minimo, int32_t maximo);
+int operacao_conjunto(int operacao, const char *destino, char **entradas, int k);
+int definir_formato(const char *nome, int formato);
+int definir_algoritmo_ordenacao(const char *nome);
+int definir_threads_ordenacao(int threads, int por_thread);
+int definir_tamanho_pagina(int kb);
+int definir_politica_alocacao(const char *nome);
+int definir_semente_geracao(unsigned long long semente);
+int definir_distribuicao(const char *nome);
+int definir_es_direta(int ativa);
+int definir_reserva_memoria(int paginas);
+int definir_compactacao_saida(int ativa);
+int definir_cache_blocos(int quadros);
+int desfragmentar(int limite_ms, int limite_mb);
+int formatar(long disco_mb, long swap_mb);
+int disco_montado();
+void estat_iniciar_operacao(const char *nome);
+void estat_terminar_operacao();
+void estat_bytes_operacao(long *lidos, long *escritos);
+int estatisticas(const char *arquivo);
+void mostrar(const char *formato, ...);
+int modo_servidor(const char *caminho, int trabalhadores);
+int modo_cliente(const char *caminho, int argc, char **argv);
+
+/* Modo em lote: executa comandos sem o menu, todos no mesmo processo (a huge page e
+   o disco são preparados uma vez só). Os comandos usam os verbos do enunciado:
+       criar <nome> <tamanho>      apagar <nome>       listar
+       ordenar <nome>              ler <nome> <início> <fim>
+       concatenar <nome1> <nome2>  buscar <nome> <mínimo> <máximo>  (arquivo ordenado)
+       estatisticas [arquivo]      (contadores; com arquivo, grava-os em JSON)
+       compactar <nome>            descompactar <nome>
+       desfragmentar [ms] [MB]     (limites de tempo e de cópia; 0 = sem limite)
+       formatar <MB> <MB de swap>  (apaga tudo e muda o tamanho do disco)
+       maiores <nome> <k>          menores <nome> <k>
+       quantis <nome> <q> [q ...]  (exatos; q de 0 a 1)
+       estimar <nome> <q> [q ...]  (quantis aproximados, uma passada)
+       histograma <nome> <baldes> [mínimo máximo]
+       intercalar <destino> <nome> <nome> [...]   (todos os números, em ordem)
+       uniao <destino> <nome> [...]                (valores distintos; com um só, sem repetições)
+       intersecao <destino> <nome> <nome> [...]   (valores presentes em todos)
+       diferenca <destino> <nome> <nome> [...]    (valores do primeiro que não estão nos outros)
+   e os de configuração:
+       algoritmo <qsort|radix|paginada>    threads <n> [1 = uma huge page por thread]
+       pagina <KB>                         politica <first|best>
+       semente <n>                         distribuicao <aleatoria|ordenada|reversa|repetida>
+       direto <0|1>                        (E/S direta com O_DIRECT)
+       memoria <huge pages>                (reserva de memória da ordenação)
+       compressao <0|1>                    (ordenar grava o resultado compactado)
+       cache <blocos>                      (cache de blocos de 4 KB; 0 desliga)
+   Vêm de argv (cada argumento é um comando), de um script (-f arquivo, uma linha por
+   comando, '#' inicia comentário) ou da entrada padrão (-f - ou só -). Depois de cada
+   comando é escrita uma linha JSON com o resultado, o tempo de parede e os bytes
+   lidos/gravados no disco; com -q, a saída normal dos comandos é descartada e só as
+   linhas JSON saem. */
+#define MAX_LINHA 1024
+#define MAX_PALAVRAS 16
+
+FILE *saida_resultados;
+
+// Escreve 's' como string JSON (entre aspas, com escapes)
+void escrever_texto_json(FILE *f, const char *s)
+{
+    fputc('"', f);
+    for (; *s; s++)
+    {
+        if (*s == '"' || *s == '\\')
+            fprintf(f, "\\%c", *s);
+        else if ((unsigned char)*s < 0x20)
+            fprintf(f, "\\u%04x", *s);
+        else
+            fputc(*s, f);
+    }
+    fputc('"', f);
+}
+
+/* Confere que p[0..n-1] são inteiros decimais em [-maximo, maximo], sem nada depois do
+   número; avisa e devolve false no primeiro que não for. */
+bool numeros_validos(char **p, int n, long maximo)
+{
+    for (int i = 0; i < n; i++)
+    {
+        char *fim;
+        errno = 0;
+        long v = strtol(p[i], &fim, 10);
+        if (fim == p[i] || *fim != '\0' || errno == ERANGE || v > maximo || v < -maximo)
+        {
+            mostrar("Número inválido: %s\n", p[i]);
+            return false;
+        }
+    }
+    return true;
+}
+
+// Valor de um argumento já conferido por numeros_validos
+long numero(const char *texto)
+{
+    return strtol(texto, NULL, 10);
+}
+
+// Executa um comando já separado em palavras; 0 se deu certo
+int executar_comando(int n, char **p)
+{
+    // Depois de um formatar que falhou, só outro formatar (ou estatisticas) roda
+    if (!disco_montado() && strcmp(p[0], "formatar") != 0 && strcmp(p[0], "estatisticas") != 0)
+    {
+        mostrar("Nenhum disco montado: formate-o com formatar <MB> <MB de swap>.\n");
+        return -1;
+    }
+    if (strcmp(p[0], "criar") == 0 && n == 3)
+        return numeros_validos(p + 2, 1, LONG_MAX) ? criar(p[1], numero(p[2])) : -1;
+    if (strcmp(p[0], "apagar") == 0 && n == 2)
+        return apagar(p[1]);
+    if (strcmp(p[0], "listar") == 0 && n == 1)
+        return listar();
+    if (strcmp(p[0], "ordenar") == 0 && n == 2)
+        return ordenar(p[1]);
+    if (strcmp(p[0], "ler") == 0 && n == 4)
+        return numeros_validos(p + 2, 2, LONG_MAX) ? ler(p[1], numero(p[2]), numero(p[3])) : -1;
+    if (strcmp(p[0], "concatenar") == 0 && n == 3)
+        return concatenar(p[1], p[2]);
+    if (strcmp(p[0], "buscar") == 0 && n == 4)
+        return numeros_validos(p + 2, 2, INT_MAX) ? buscar(p[1], numero(p[2]), numero(p[3])) : -1;
+    if ((strcmp(p[0], "compactar") == 0 || strcmp(p[0], "descompactar") == 0) && n == 2)
+        return definir_formato(p[1], p[0][0] == 'c');
+    if (strcmp(p[0], "desfragmentar") == 0 && n <= 3)
+    {
+        if (!numeros_validos(p + 1, n - 1, INT_MAX))
+            return -1;
+        return desfragmentar(n >= 2 ? numero(p[1]) : 0, n == 3 ? numero(p[2]) : 0);
+    }
+    if (strcmp(p[0], "formatar") == 0 && n == 3)
+        return numeros_validos(p + 1, 2, LONG_MAX) ? formatar(numero(p[1]), numero(p[2])) : -1;
+    if ((strcmp(p[0], "maiores") == 0 || strcmp(p[0], "menores") == 0) && n == 3)
+        return numeros_validos(p + 2, 1, LONG_MAX) ? extremos(p[1], numero(p[2]), p[0][1] == 'a') : -1;
+    if ((strcmp(p[0], "quantis") == 0 || strcmp(p[0], "estimar") == 0) && n >= 3)
+    {
+        double q[MAX_PALAVRAS];
+        for (int i = 2; i < n; i++)
+        {
+            char *fim;
+            q[i - 2] = strtod(p[i], &fim);
+            if (fim == p[i] || *fim != '\0')
+            {
+                mostrar("Número inválido: %s\n", p[i]);
+                return -1;
+            }
+        }
+        return quantis(p[1], q, n - 2, p[0][0] == 'e');
+    }
+    if (strcmp(p[0], "histograma") == 0 && (n == 3 || n == 5))
+    {
+        if (!numeros_validos(p + 2, n - 2, INT_MAX))
+            return -1;
+        return histograma(p[1], numero(p[2]), n == 5, n == 5 ? numero(p[3]) : 0, n == 5 ? numero(p[4]) : 0);
+    }
+    const char *conjuntos[] = {"intercalar", "uniao", "intersecao", "diferenca"};
+    for (int i = 0; i < 4; i++)
+        if (strcmp(p[0], conjuntos[i]) == 0 && n >= 3)
+            return operacao_conjunto(i, p[1], p + 2, n - 2);
+    if (strcmp(p[0], "algoritmo") == 0 && n == 2)
+        return definir_algoritmo_ordenacao(p[1]);
+    if (strcmp(p[0], "threads") == 0 && (n == 2 || n == 3))
+    {
+        if (!numeros_validos(p + 1, n - 1, INT_MAX))
+            return -1;
+        return definir_threads_ordenacao(numero(p[1]), n == 3 ? numero(p[2]) : 0);
+    }
+    if (strcmp(p[0], "pagina") == 0 && n == 2)
+        return numeros_validos(p + 1, 1, INT_MAX) ? definir_tamanho_pagina(numero(p[1])) : -1;
+    if (strcmp(p[0], "politica") == 0 && n == 2)
+        return definir_politica_alocacao(p[1]);
+    if (strcmp(p[0], "semente") == 0 && n == 2)
+    {
+        char *fim;
+        errno = 0;
+        unsigned long long semente = strtoull(p[1], &fim, 10);
+        if (p[1][0] == '-' || fim == p[1] || *fim != '\0' || errno == ERANGE)
+        {
+            mostrar("Número inválido: %s\n", p[1]);
+            return -1;
+        }
+        return definir_semente_geracao(semente);
+    }
+    if (strcmp(p[0], "memoria") == 0 && n == 2)
+        return numeros_validos(p + 1, 1, INT_MAX) ? definir_reserva_memoria(numero(p[1])) : -1;
+    if (strcmp(p[0], "direto") == 0 && n == 2)
+        return numeros_validos(p + 1, 1, INT_MAX) ? definir_es_direta(numero(p[1])) : -1;
+    if (strcmp(p[0], "compressao") == 0 && n == 2)
+        return numeros_validos(p + 1, 1, INT_MAX) ? definir_compactacao_saida(numero(p[1])) : -1;
+    if (strcmp(p[0], "cache") == 0 && n == 2)
+        return numeros_validos(p + 1, 1, INT_MAX) ? definir_cache_blocos(numero(p[1])) : -1;
+    if (strcmp(p[0], "estatisticas") == 0 && n <= 2)
+        return estatisticas(n == 2 ? p[1] : NULL);
+    if (strcmp(p[0], "distribuicao") == 0 && n == 2)
+        return definir_distribuicao(p[1]);
+
+    mostrar("Comando inválido: %s\n", p[0]);
+    return -1;
+}
+
+/* Separa 'texto' (modificado no lugar) em até MAX_PALAVRAS palavras; devolve quantas.
+   Usa strtok_r porque o servidor separa linhas em várias threads ao mesmo tempo. */
+int separar_palavras(char *texto, char **palavras)
+{
+    int n = 0;
+    char *resto;
+    for (char *t = strtok_r(texto, " \t", &resto); t && n < MAX_PALAVRAS; t = strtok_r(NULL, " \t", &resto))
+        palavras[n++] = t;
+    return n;
+}
+
+/* Executa uma linha de comando e escreve o resultado. Devolve 1 se falhou, 0 se deu
+   certo ou se a linha estava vazia/era comentário. */
+int processar_linha(const char *linha, int *numero)
+{
+    char texto[MAX_LINHA], copia[MAX_LINHA];
+    char *palavras[MAX_PALAVRAS];
+
+    snprintf(texto, sizeof(texto), "%s", linha);
+    texto[strcspn(texto, "#\r\n")] = '\0';
+    strcpy(copia, texto);
+    int n = separar_palavras(copia, palavras);
+    if (n == 0)
+        return 0;
+
+    // O próprio comando estatisticas não zera os contadores da última operação
+    if (strcmp(palavras[0], "estatisticas") != 0)
+        estat_iniciar_operacao(texto + strspn(texto, " \t"));
+
+    struct timespec inicio, fim;
+    long lidos_antes, escritos_antes, lidos, escritos;
+    estat_bytes_operacao(&lidos_antes, &escritos_antes);
+    clock_gettime(CLOCK_MONOTONIC, &inicio);
+    int status = executar_comando(n, palavras);
+    clock_gettime(CLOCK_MONOTONIC, &fim);
+    estat_bytes_operacao(&lidos, &escritos);
+    estat_terminar_operacao();
+    fflush(stdout);
+
+    (*numero)++;
+    fprintf(saida_resultados, "{\"n\":%d,\"comando\":", *numero);
+    escrever_texto_json(saida_resultados, texto + strspn(texto, " \t"));
+    fprintf(saida_resultados, ",\"status\":\"%s\",\"ms\":%.3f,\"bytes_lidos\":%ld,\"bytes_escritos\":%ld}\n",
+            status == 0 ? "ok" : "erro", (fim.tv_sec - inicio.tv_sec) * 1000.0 + (fim.tv_nsec - inicio.tv_nsec) / 1e6,
+            lidos - lidos_antes, escritos - escritos_antes);
+    fflush(saida_resultados);
+    return status != 0;
+}
+
+int executar_script(const char *caminho, int *numero)
+{
+    FILE *f = strcmp(caminho, "-") == 0 ? stdin : fopen(caminho, "r");
+    if (!f)
+    {
+        perror("Erro ao abrir script");
+        return 1;
+    }
+    int falhas = 0;
+    char linha[MAX_LINHA];
+    while (fgets(linha, sizeof(linha), f))
+        falhas += processar_linha(linha, numero);
+    if (f != stdin)
+        fclose(f);
+    return falhas;
+}
+
+// Uso: mini_sistema [-q] [-f script | -] ["comando" ...]
+int modo_lote(int argc, char **argv)
+{
+    int silencioso = 0;
+    for (int i = 1; i < argc; i++)
+        if (strcmp(argv[i], "-q") == 0)
+            silencioso = 1;
+
+    saida_resultados = stdout;
+    if (silencioso)
+    {
+        saida_resultados = fdopen(dup(STDOUT_FILENO), "w");
+        if (!saida_resultados || !freopen("/dev/null", "w", stdout))
+        {
+            perror("Erro ao preparar a saída");
+            return EXIT_FAILURE;
+        }
+    }
+
+    sistema_arquivos();
+
+    struct timespec inicio, fim;
+    clock_gettime(CLOCK_MONOTONIC, &inicio);
+    int falhas = 0, numero = 0;
+    for (int i = 1; i < argc; i++)
+    {
+        if (strcmp(argv[i], "-q") == 0)
+            continue;
+        if (strcmp(argv[i], "-") == 0)
+            falhas += executar_script("-", &numero);
+        else if (strcmp(argv[i], "-f") == 0)
+        {
+            if (i + 1 >= argc)
+            {
+                fprintf(stderr, "Uso: %s [-q] [-f script | -] [\"comando\" ...]\n", argv[0]);
+                return EXIT_FAILURE;
+            }
+            falhas += executar_script(argv[++i], &numero);
+        }
+        else
+            falhas += processar_linha(argv[i], &numero);
+    }
+    clock_gettime(CLOCK_MONOTONIC, &fim);
+
+    fprintf(saida_resultados, "{\"comandos\":%d,\"falhas\":%d,\"ms\":%.3f}\n", numero, falhas,
+            (fim.tv_sec - inicio.tv_sec) * 1000.0 + (fim.tv_nsec - inicio.tv_nsec) / 1e6);
+    fflush(saida_resultados);
+    return falhas ? EXIT_FAILURE : EXIT_SUCCESS;
+}
+
+int main(int argc, char **argv)
 {
     int escolha;
 
-    // Inicializa o sistema de arquivos
     srand(time(NULL));
+
+    // mini_sistema -s <socket> [trabalhadores]: servidor; -c <socket> ...: cliente dele
+    if (argc > 2 && strcmp(argv[1], "-s") == 0)
+        return modo_servidor(argv[2], argc > 3 ? atoi(argv[3]) : 0);
+    if (argc > 2 && strcmp(argv[1], "-c") == 0)
+        return modo_cliente(argv[2], argc - 2, argv + 2);
+
+    // Com argumentos, roda os comandos em lote em vez do menu
+    if (argc > 1)
+        return modo_lote(argc, argv);
+
+    // Inicializa o sistema de arquivos
     sistema_arquivos();
 
     while (true)
@@ -29,12 +366,19 @@ int main()
         printf("4 - Ordenar a lista no arquivo\n");
         printf("5 - Exibir sublista de um arquivo\n");
         printf("6 - Concatenar dois arquivos\n");
+        printf("7 - Configurações\n");
+        printf("8 - Estatísticas de desempenho\n");
+        printf("9 - Buscar valores em um arquivo ordenado\n");
+        printf("10 - Compactar ou descompactar um arquivo\n");
+        printf("11 - Desfragmentar o disco\n");
+        printf("12 - Consultar sem ordenar (maiores, menores, quantis, histograma)\n");
+        printf("13 - Operações de conjunto (intercalar, união, interseção, diferença)\n");
         printf("0 - Sair\n");
         printf("Escolha uma opção: ");
         scanf("%d", &escolha);
 
         // Verifica se a escolha é válida
-        if (escolha < 0 || escolha > 6)
+        if (escolha < 0 || escolha > 13)
         {
             printf("Opção inválida! Tente novamente.\n");
             continue;
@@ -47,17 +391,30 @@ int main()
             break;
         }
 
+        // Sem disco montado (um formatar falhou), só as configurações e as estatísticas
+        if (!disco_montado() && escolha != 7 && escolha != 8)
+        {
+            printf("Nenhum disco montado: formate-o em Configurações.\n");
+            continue;
+        }
+
+        // Zera os contadores da operação corrente antes de cada comando de arquivo
+        const char *operacoes[] = {"", "criar", "apagar", "listar", "ordenar", "ler", "concatenar", "", "", "buscar",
+                                   "compactar", "desfragmentar", "consulta", "conjunto"};
+        if (escolha <= 6 || escolha >= 9)
+            estat_iniciar_operacao(operacoes[escolha]);
+
         // Executa a função correspondente à escolha
         switch (escolha)
         {
         case 1:
         {
             char nome[32];
-            int tam;
+            long tam;
             printf("Digite o nome do arquivo: ");
             scanf("%s", nome);
             printf("Digite o tamanho do arquivo (quantidade de números): ");
-            scanf("%d", &tam);
+            scanf("%ld", &tam);
             criar(nome, tam);
             break;
         }
@@ -83,11 +440,11 @@ int main()
         case 5:
         {
             char nome[32];
-            int inicio, fim;
+            long inicio, fim;
             printf("Digite o nome do arquivo: ");
             scanf("%s", nome);
             printf("Digite o início e o fim do intervalo: ");
-            scanf("%d %d", &inicio, &fim);
+            scanf("%ld %ld", &inicio, &fim);
             ler(nome, inicio, fim);
             break;
         }
@@ -101,7 +458,226 @@ int main()
             concatenar(nome1, nome2);
             break;
         }
+        case 7:
+        {
+            int opcao;
+            printf("1 - Algoritmo de ordenação\n");
+            printf("2 - Threads da ordenação e da criação\n");
+            printf("3 - Tamanho de página da memória virtual\n");
+            printf("4 - Política de alocação de blocos\n");
+            printf("5 - Semente do gerador de números\n");
+            printf("6 - Distribuição dos números gerados\n");
+            printf("7 - E/S direta (O_DIRECT, sem page cache)\n");
+            printf("8 - Reserva de memória (huge pages)\n");
+            printf("9 - Ordenação grava o resultado compactado\n");
+            printf("10 - Cache de blocos\n");
+            printf("11 - Formatar o disco (apaga todos os arquivos)\n");
+            printf("Escolha uma opção: ");
+            scanf("%d", &opcao);
+            if (opcao == 1)
+            {
+                char algoritmo[16];
+                printf("Digite o algoritmo (qsort, radix ou paginada): ");
+                scanf("%15s", algoritmo);
+                definir_algoritmo_ordenacao(algoritmo);
+            }
+            else if (opcao == 2)
+            {
+                int threads, por_thread;
+                printf("Digite o número de threads: ");
+                scanf("%d", &threads);
+                printf("Uma huge page por thread? (0 - não, 1 - sim): ");
+                scanf("%d", &por_thread);
+                definir_threads_ordenacao(threads, por_thread);
+            }
+            else if (opcao == 3)
+            {
+                int kb;
+                printf("Digite o tamanho da página em KB: ");
+                scanf("%d", &kb);
+                definir_tamanho_pagina(kb);
+            }
+            else if (opcao == 4)
+            {
+                char politica[16];
+                printf("Digite a política (first ou best): ");
+                scanf("%15s", politica);
+                definir_politica_alocacao(politica);
+            }
+            else if (opcao == 5)
+            {
+                unsigned long long semente;
+                printf("Digite a semente: ");
+                scanf("%llu", &semente);
+                definir_semente_geracao(semente);
+            }
+            else if (opcao == 6)
+            {
+                char distribuicao[16];
+                printf("Digite a distribuição (aleatoria, ordenada, reversa ou repetida): ");
+                scanf("%15s", distribuicao);
+                definir_distribuicao(distribuicao);
+            }
+            else if (opcao == 7)
+            {
+                int ativa;
+                printf("Ligar a E/S direta? (0 - não, 1 - sim): ");
+                scanf("%d", &ativa);
+                definir_es_direta(ativa);
+            }
+            else if (opcao == 8)
+            {
+                int paginas;
+                printf("Digite quantas huge pages de 2 MB reservar: ");
+                scanf("%d", &paginas);
+                definir_reserva_memoria(paginas);
+            }
+            else if (opcao == 9)
+            {
+                int ativa;
+                printf("Compactar o resultado da ordenação? (0 - não, 1 - sim): ");
+                scanf("%d", &ativa);
+                definir_compactacao_saida(ativa);
+            }
+            else if (opcao == 10)
+            {
+                int quadros;
+                printf("Digite quantos blocos de 4 KB o cache deve ter (0 - desligar): ");
+                scanf("%d", &quadros);
+                definir_cache_blocos(quadros);
+            }
+            else if (opcao == 11)
+            {
+                long disco_mb, swap_mb;
+                printf("Digite o tamanho do disco e o da área de swap, em MB: ");
+                scanf("%ld %ld", &disco_mb, &swap_mb);
+                formatar(disco_mb, swap_mb);
+            }
+            else
+                printf("Opção inválida!\n");
+            break;
+        }
+        case 8:
+        {
+            int opcao;
+            printf("1 - Exibir\n");
+            printf("2 - Gravar em arquivo (JSON)\n");
+            printf("Escolha uma opção: ");
+            scanf("%d", &opcao);
+            if (opcao == 1)
+                estatisticas(NULL);
+            else if (opcao == 2)
+            {
+                char arquivo[256];
+                printf("Digite o nome do arquivo: ");
+                scanf("%255s", arquivo);
+                estatisticas(arquivo);
+            }
+            else
+                printf("Opção inválida!\n");
+            break;
+        }
+        case 9:
+        {
+            char nome[32];
+            int minimo, maximo;
+            printf("Digite o nome do arquivo: ");
+            scanf("%s", nome);
+            printf("Digite o menor e o maior valor: ");
+            scanf("%d %d", &minimo, &maximo);
+            buscar(nome, minimo, maximo);
+            break;
+        }
+        case 10:
+        {
+            char nome[32];
+            int formato;
+            printf("Digite o nome do arquivo: ");
+            scanf("%s", nome);
+            printf("1 - Compactar\n");
+            printf("0 - Descompactar\n");
+            printf("Escolha uma opção: ");
+            scanf("%d", &formato);
+            definir_formato(nome, formato == 1);
+            break;
+        }
+        case 11:
+        {
+            int limite_ms, limite_mb;
+            printf("Digite o limite de tempo em ms e o de cópia em MB (0 = sem limite): ");
+            scanf("%d %d", &limite_ms, &limite_mb);
+            desfragmentar(limite_ms, limite_mb);
+            break;
+        }
+        case 12:
+        {
+            char nome[32];
+            int opcao;
+            printf("Digite o nome do arquivo: ");
+            scanf("%s", nome);
+            printf("1 - Maiores números\n");
+            printf("2 - Menores números\n");
+            printf("3 - Quantil exato\n");
+            printf("4 - Quantil aproximado\n");
+            printf("5 - Histograma\n");
+            printf("Escolha uma opção: ");
+            scanf("%d", &opcao);
+            if (opcao == 1 || opcao == 2)
+            {
+                long k;
+                printf("Digite quantos números: ");
+                scanf("%ld", &k);
+                extremos(nome, k, opcao == 1);
+            }
+            else if (opcao == 3 || opcao == 4)
+            {
+                double q;
+                printf("Digite o quantil (0 a 1, ex.: 0.5 para a mediana): ");
+                scanf("%lf", &q);
+                quantis(nome, &q, 1, opcao == 4);
+            }
+            else if (opcao == 5)
+            {
+                int baldes;
+                printf("Digite o número de baldes: ");
+                scanf("%d", &baldes);
+                histograma(nome, baldes, 0, 0, 0);
+            }
+            else
+                printf("Opção inválida!\n");
+            break;
+        }
+        case 13:
+        {
+            char destino[32], nomes[MAX_PALAVRAS][32];
+            char *entradas[MAX_PALAVRAS];
+            int opcao, k;
+            printf("0 - Intercalar (todos os números)\n");
+            printf("1 - União (valores distintos)\n");
+            printf("2 - Interseção\n");
+            printf("3 - Diferença (o primeiro menos os outros)\n");
+            printf("Escolha uma opção: ");
+            scanf("%d", &opcao);
+            printf("Digite o nome do arquivo de destino: ");
+            scanf("%31s", destino);
+            printf("Digite quantos arquivos de entrada (até %d): ", MAX_PALAVRAS);
+            scanf("%d", &k);
+            if (opcao < 0 || opcao > 3 || k < 1 || k > MAX_PALAVRAS)
+            {
+                printf("Opção inválida!\n");
+                break;
+            }
+            for (int i = 0; i < k; i++)
+            {
+                printf("Digite o nome do arquivo %d: ", i + 1);
+                scanf("%31s", nomes[i]);
+                entradas[i] = nomes[i];
+            }
+            operacao_conjunto(opcao, destino, entradas, k);
+            break;
+        }
         }
+        estat_terminar_operacao();
     }
 
     return 0;
@@ -1,36 +1,235 @@
 #define _GNU_SOURCE // Deve vir antes de qualquer include
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <pthread.h>
 #include <sys/mman.h>
 #include <sys/types.h>
 #include <fcntl.h>
 #include <unistd.h> // Adicionado para munmap()
 
 #define HUGE_PAGE_SIZE (2 * 1024 * 1024)
+#define MAX_PAGINAS_RESERVA 1024 // 2 GB
 
-void *alocar_huge_page()
+// Declarações externas dos contadores de desempenho (implementados em estatisticas.c)
+extern long estat_agora();
+extern void estat_huge_page(int sucesso, long ns);
+
+// Declarações externas da saída dos comandos (implementada em servidor.c)
+extern void mostrar(const char *formato, ...);
+
+/* Reserva de huge pages. Na inicialização, 'paginas_reserva' huge pages contíguas são
+   mapeadas uma vez só (hugetlbfs com MAP_HUGETLB; sem ele, memória anônima alinhada a
+   2 MB com madvise(MADV_HUGEPAGE), para o THP) e já tocadas, então nenhuma alocação
+   posterior paga mmap nem falta de página. Dali em diante a reserva funciona como um
+   pool de huge pages inteiras: cada pedido recebe um trecho contíguo de páginas
+   (first-fit) e quem recebe reparte o trecho entre os próprios buffers. */
+char *reserva = NULL;
+int paginas_reserva = 0;
+int reserva_thp = 0;                         // 1 se a reserva veio do THP, não do hugetlbfs
+int alocacao_pagina[MAX_PAGINAS_RESERVA];    // Páginas do trecho que começa aqui (0: livre/meio de trecho)
+unsigned char pagina_ocupada[MAX_PAGINAS_RESERVA];
+int paginas_em_uso = 0;
+__thread int paginas_da_thread = 0;          // Das em uso, as que esta thread pegou (e devolverá)
+pthread_mutex_t reserva_mutex = PTHREAD_MUTEX_INITIALIZER;
+pthread_cond_t reserva_devolvida = PTHREAD_COND_INITIALIZER; // Algum trecho voltou para a reserva
+
+void liberar_reserva()
 {
-    void *page = mmap(NULL, HUGE_PAGE_SIZE, PROT_READ | PROT_WRITE,
-                      MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+    if (reserva)
+        munmap(reserva, (size_t)paginas_reserva * HUGE_PAGE_SIZE);
+    reserva = NULL;
+    paginas_reserva = 0;
+}
 
-    if (page == MAP_FAILED)
+// Mapeia a reserva; -1 se nem hugetlbfs nem THP conseguiram a memória
+int mapear_reserva(int paginas)
+{
+    size_t bytes = (size_t)paginas * HUGE_PAGE_SIZE;
+    long inicio = estat_agora();
+    void *m = mmap(NULL, bytes, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB | MAP_POPULATE,
+                   -1, 0);
+    reserva_thp = 0;
+    if (m == MAP_FAILED)
     {
-        perror("\nErro na alocação de Huge Page");
-        fprintf(stderr, "Verifique:\n"
-                        "1. sudo sysctl vm.nr_hugepages=2\n"
-                        "2. Permissões de usuário\n"
-                        "3. Memória disponível\n");
-        return NULL;
+        // Sem hugetlbfs: mapeia com folga para alinhar a 2 MB e pede huge pages ao THP
+        char *bruto = mmap(NULL, bytes + HUGE_PAGE_SIZE, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+        if (bruto == MAP_FAILED)
+        {
+            estat_huge_page(0, estat_agora() - inicio);
+            return -1;
+        }
+        char *alinhado = (char *)(((uintptr_t)bruto + HUGE_PAGE_SIZE - 1) & ~(uintptr_t)(HUGE_PAGE_SIZE - 1));
+        if (alinhado > bruto)
+            munmap(bruto, alinhado - bruto);
+        munmap(alinhado + bytes, bruto + HUGE_PAGE_SIZE - alinhado);
+        madvise(alinhado, bytes, MADV_HUGEPAGE);
+        memset(alinhado, 0, bytes); // Faltas de página agora, não na ordenação
+        m = alinhado;
+        reserva_thp = 1;
     }
-    return page;
+    estat_huge_page(1, estat_agora() - inicio);
+
+    reserva = m;
+    paginas_reserva = paginas;
+    memset(alocacao_pagina, 0, sizeof(alocacao_pagina));
+    memset(pagina_ocupada, 0, sizeof(pagina_ocupada));
+    return 0;
 }
 
-void liberar_huge_page(void *page)
+/* Prepara (ou troca) a reserva com 'paginas' huge pages. Só pode trocar quando nada
+   dela está em uso; se a nova reserva falhar, a anterior é refeita. */
+int memoria_iniciar(int paginas)
+{
+    if (paginas < 1 || paginas > MAX_PAGINAS_RESERVA)
+    {
+        mostrar("Reserva de memória inválida (1 a %d huge pages).\n", MAX_PAGINAS_RESERVA);
+        return -1;
+    }
+    pthread_mutex_lock(&reserva_mutex);
+    if (paginas_em_uso > 0)
+    {
+        pthread_mutex_unlock(&reserva_mutex);
+        mostrar("A reserva de memória está em uso.\n");
+        return -1;
+    }
+    int anteriores = paginas_reserva;
+    liberar_reserva();
+    int r = mapear_reserva(paginas);
+    if (r == -1)
+    {
+        perror("\nErro na reserva de Huge Pages");
+        if (anteriores > 0 && mapear_reserva(anteriores) == -1)
+            mostrar("A reserva anterior (%d huge pages) também não pôde ser refeita: não há reserva de memória, "
+                    "e a ordenação e as consultas falham até um memoria <n> dar certo.\n", anteriores);
+    }
+    pthread_mutex_unlock(&reserva_mutex);
+    return r;
+}
+
+void exibir_reserva()
+{
+    mostrar("Reserva de memória: %d huge page(s) de 2 MB (%s), %d em uso.\n", paginas_reserva,
+           reserva_thp ? "THP via madvise" : "hugetlbfs", paginas_em_uso);
+}
+
+// Comando de configuração: troca o tamanho da reserva (a ordenação usa toda ela)
+int definir_reserva_memoria(int paginas)
+{
+    if (memoria_iniciar(paginas) == -1)
+        return -1;
+    exibir_reserva();
+    return 0;
+}
+
+// Marca o trecho [inicio, inicio + n) como alocado e devolve seu endereço
+void *ocupar_paginas(int inicio, int n)
+{
+    memset(&pagina_ocupada[inicio], 1, n);
+    alocacao_pagina[inicio] = n;
+    paginas_em_uso += n;
+    paginas_da_thread += n;
+    return reserva + (size_t)inicio * HUGE_PAGE_SIZE;
+}
+
+/* Pega da reserva um trecho contíguo de pelo menos 'bytes' (em huge pages inteiras,
+   alinhado a 2 MB). NULL se não há trecho livre desse tamanho. */
+void *memoria_alocar(size_t bytes)
+{
+    int n = (bytes + HUGE_PAGE_SIZE - 1) / HUGE_PAGE_SIZE;
+    void *p = NULL;
+    pthread_mutex_lock(&reserva_mutex);
+    for (int i = 0, livres = 0; i < paginas_reserva && n > 0; i++)
+    {
+        livres = pagina_ocupada[i] ? 0 : livres + 1;
+        if (livres == n)
+        {
+            p = ocupar_paginas(i - n + 1, n);
+            break;
+        }
+    }
+    pthread_mutex_unlock(&reserva_mutex);
+    return p;
+}
+
+/* Pega o maior trecho livre da reserva; '*bytes' recebe o tamanho. É o que a
+   ordenação usa: toda a memória disponível, não só uma huge page. Se a reserva toda
+   está com outros comandos (modo servidor), espera algum deles devolver um trecho.
+   Só espera pelas páginas de outras threads: se as que estão em uso são todas da
+   própria thread, ninguém as devolveria, então devolve NULL. */
+void *memoria_alocar_maior(size_t *bytes)
 {
-    if (page != NULL)
+    int melhor = -1, tamanho = 0;
+    void *p = NULL;
+    pthread_mutex_lock(&reserva_mutex);
+    while (1)
     {
-        munmap(page, HUGE_PAGE_SIZE);
+        for (int i = 0, livres = 0; i < paginas_reserva; i++)
+        {
+            livres = pagina_ocupada[i] ? 0 : livres + 1;
+            if (livres > tamanho)
+            {
+                tamanho = livres;
+                melhor = i - livres + 1;
+            }
+        }
+        if (melhor >= 0 || paginas_em_uso <= paginas_da_thread)
+            break;
+        pthread_cond_wait(&reserva_devolvida, &reserva_mutex);
     }
+    if (melhor >= 0)
+        p = ocupar_paginas(melhor, tamanho);
+    pthread_mutex_unlock(&reserva_mutex);
+    *bytes = (size_t)tamanho * HUGE_PAGE_SIZE;
+    return p;
+}
+
+// Devolve à reserva um trecho de memoria_alocar/memoria_alocar_maior
+void memoria_liberar(void *p)
+{
+    if (!p)
+        return;
+    pthread_mutex_lock(&reserva_mutex);
+    int inicio = ((char *)p - reserva) / HUGE_PAGE_SIZE;
+    int n = alocacao_pagina[inicio];
+    memset(&pagina_ocupada[inicio], 0, n);
+    alocacao_pagina[inicio] = 0;
+    paginas_em_uso -= n;
+    paginas_da_thread -= n;
+    pthread_cond_broadcast(&reserva_devolvida);
+    pthread_mutex_unlock(&reserva_mutex);
+}
+
+/* Buffers de E/S (criação, cópia): vêm da reserva quando há páginas livres e, se não
+   houver, do heap, alinhados a 'alinhamento' (para continuarem aptos a O_DIRECT). */
+void *memoria_obter(size_t bytes, size_t alinhamento)
+{
+    void *p = memoria_alocar(bytes);
+    if (!p && posix_memalign(&p, alinhamento, bytes) != 0)
+        p = NULL;
+    return p;
+}
+
+void memoria_devolver(void *p)
+{
+    if (reserva && (char *)p >= reserva && (char *)p < reserva + (size_t)paginas_reserva * HUGE_PAGE_SIZE)
+        memoria_liberar(p);
+    else
+        free(p);
+}
+
+void *alocar_huge_page()
+{
+    void *page = memoria_alocar(HUGE_PAGE_SIZE);
+    if (page == NULL)
+        fprintf(stderr, "Nenhuma huge page livre na reserva de memória.\n");
+    return page;
+}
+
+void liberar_huge_page(void *page)
+{
+    memoria_liberar(page);
 }
 
 void gerenciamento_memoria()
@@ -38,7 +237,7 @@ void gerenciamento_memoria()
     void *page = alocar_huge_page();
     if (page)
     {
-        printf("Huge Page alocada em %p\n", page);
+        mostrar("Huge Page alocada em %p\n", page);
         liberar_huge_page(page);
     }
 }
\ No newline at end of file
@@ -0,0 +1,280 @@
+#define _GNU_SOURCE // Deve vir antes de qualquer include
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <sys/types.h>
+
+/* Memória virtual paginada para a ordenação.
+   Um vetor virtual de int32_t, maior que a memória física, é dividido em páginas de
+   tamanho fixo. A memória física (normalmente a huge page) é dividida em quadros do
+   mesmo tamanho; a tabela de páginas diz em que quadro cada página está. A troca usa
+   o algoritmo do relógio (CLOCK) e só grava de volta páginas sujas.
+   Fora da memória, a página 'p' mora na posição lógica p * tam_pagina de um
+   armazenamento externo, acessado por funções de leitura/escrita: na ordenação, o
+   conteúdo do próprio arquivo, que assim é ordenado no lugar sem usar a swap. */
+
+#define BLOCK_SIZE 4096
+
+// Declarações externas (implementadas em disco_virtual.c)
+extern void estat_paginacao(long faltas, long despejos, long gravacoes);
+extern void mostrar(const char *formato, ...); // servidor.c
+
+typedef struct
+{
+    int quadro;        // Quadro onde a página está, ou -1
+    unsigned char suja;
+    unsigned char referenciada;
+    int fixacoes;      // Páginas fixadas não são despejadas
+} EntradaPagina;
+
+// Leitura/escrita de 'len' bytes na posição lógica 'pos' do armazenamento externo
+typedef ssize_t (*FuncaoES)(void *contexto, void *buf, size_t len, off_t pos);
+
+typedef struct MemoriaVirtual
+{
+    char *memoria;            // Memória física dividida em quadros
+    int tam_pagina;           // Em bytes, múltiplo de BLOCK_SIZE
+    int elementos_por_pagina;
+    int num_quadros;
+    int *pagina_do_quadro;    // Página em cada quadro, ou -1
+    int ponteiro;             // Ponteiro do relógio
+    long num_elementos;
+    long num_paginas;
+    EntradaPagina *tabela;
+    FuncaoES ler, escrever;   // Armazenamento externo
+    void *contexto;
+    int erro;                 // Alguma página não pôde ser lida, gravada ou trazida
+
+    // Contadores para ajustar o tamanho de página à carga
+    long faltas;
+    long despejos;
+    long escritas_volta;
+    long acessos;
+} MemoriaVirtual;
+
+// Bytes da página 'p' que existem de fato (a última pode ser parcial)
+size_t mv_bytes_pagina(MemoriaVirtual *mv, long p)
+{
+    long restantes = mv->num_elementos - p * mv->elementos_por_pagina;
+    if (restantes > mv->elementos_por_pagina)
+        restantes = mv->elementos_por_pagina;
+    return restantes * sizeof(int32_t);
+}
+
+void mv_gravar_quadro(MemoriaVirtual *mv, int q, long p)
+{
+    char *quadro = mv->memoria + (size_t)q * mv->tam_pagina;
+    ssize_t r = mv->escrever(mv->contexto, quadro, mv_bytes_pagina(mv, p), (off_t)p * mv->tam_pagina);
+    if (r != (ssize_t)mv_bytes_pagina(mv, p))
+    {
+        mostrar("Erro ao gravar a página %ld da memória virtual.\n", p);
+        mv->erro = 1;
+    }
+    mv->escritas_volta++;
+}
+
+// Escolhe um quadro pelo relógio, despejando (e gravando se suja) a página que estava nele
+int mv_obter_quadro(MemoriaVirtual *mv)
+{
+    for (int voltas = 0; voltas < 2 * mv->num_quadros + 1; voltas++)
+    {
+        int q = mv->ponteiro;
+        mv->ponteiro = (mv->ponteiro + 1) % mv->num_quadros;
+
+        int p = mv->pagina_do_quadro[q];
+        if (p == -1)
+            return q;
+
+        EntradaPagina *e = &mv->tabela[p];
+        if (e->fixacoes > 0)
+            continue;
+        if (e->referenciada)
+        {
+            e->referenciada = 0; // Segunda chance
+            continue;
+        }
+
+        if (e->suja)
+            mv_gravar_quadro(mv, q, p);
+        e->quadro = -1;
+        e->suja = 0;
+        mv->pagina_do_quadro[q] = -1;
+        mv->despejos++;
+        return q;
+    }
+    mostrar("Todas as páginas estão fixadas: sem quadro livre.\n");
+    mv->erro = 1;
+    return -1;
+}
+
+/* Garante que a página 'p' está em um quadro e devolve o endereço dele. Se a página não
+   pôde ser trazida (sem quadro ou leitura curta), o quadro fica livre, o vetor fica
+   marcado com erro e devolve NULL. */
+int32_t *mv_carregar(MemoriaVirtual *mv, long p)
+{
+    EntradaPagina *e = &mv->tabela[p];
+    mv->acessos++;
+    if (e->quadro == -1)
+    {
+        int q = mv_obter_quadro(mv);
+        if (q == -1)
+            return NULL;
+
+        char *quadro = mv->memoria + (size_t)q * mv->tam_pagina;
+        ssize_t r = mv->ler(mv->contexto, quadro, mv_bytes_pagina(mv, p), (off_t)p * mv->tam_pagina);
+        if (r != (ssize_t)mv_bytes_pagina(mv, p))
+        {
+            mostrar("Erro ao ler a página %ld da memória virtual.\n", p);
+            mv->erro = 1;
+            return NULL;
+        }
+
+        e->quadro = q;
+        mv->pagina_do_quadro[q] = p;
+        mv->faltas++;
+    }
+    e->referenciada = 1;
+    return (int32_t *)(mv->memoria + (size_t)e->quadro * mv->tam_pagina);
+}
+
+/* Cria um vetor virtual de 'num_elementos' inteiros usando 'memoria' (tam_memoria
+   bytes) como quadros de 'tam_pagina' bytes. O vetor é o conteúdo do armazenamento
+   externo, acessado por 'ler' e 'escrever' (chamados com 'contexto'). */
+MemoriaVirtual *mv_criar(void *memoria, size_t tam_memoria, int tam_pagina, long num_elementos,
+                         FuncaoES ler, FuncaoES escrever, void *contexto)
+{
+    if (tam_pagina < BLOCK_SIZE || tam_pagina % BLOCK_SIZE != 0 || tam_memoria < (size_t)tam_pagina)
+    {
+        mostrar("Tamanho de página inválido para a memória virtual.\n");
+        return NULL;
+    }
+
+    MemoriaVirtual *mv = calloc(1, sizeof(MemoriaVirtual));
+    if (!mv)
+    {
+        mostrar("Sem memória para a tabela de páginas.\n");
+        return NULL;
+    }
+    mv->memoria = memoria;
+    mv->tam_pagina = tam_pagina;
+    mv->elementos_por_pagina = tam_pagina / sizeof(int32_t);
+    mv->num_quadros = tam_memoria / tam_pagina;
+    mv->num_elementos = num_elementos;
+    mv->num_paginas = (num_elementos + mv->elementos_por_pagina - 1) / mv->elementos_por_pagina;
+    mv->ler = ler;
+    mv->escrever = escrever;
+    mv->contexto = contexto;
+
+    mv->pagina_do_quadro = malloc(mv->num_quadros * sizeof(int));
+    mv->tabela = malloc(mv->num_paginas * sizeof(EntradaPagina));
+    if (!mv->pagina_do_quadro || !mv->tabela)
+    {
+        mostrar("Sem memória para a tabela de páginas.\n");
+        free(mv->pagina_do_quadro);
+        free(mv->tabela);
+        free(mv);
+        return NULL;
+    }
+    for (int q = 0; q < mv->num_quadros; q++)
+        mv->pagina_do_quadro[q] = -1;
+    for (long p = 0; p < mv->num_paginas; p++)
+        mv->tabela[p] = (EntradaPagina){-1, 0, 0, 0};
+    return mv;
+}
+
+// Grava de volta todas as páginas sujas que estão na memória
+void mv_sincronizar(MemoriaVirtual *mv)
+{
+    for (int q = 0; q < mv->num_quadros; q++)
+    {
+        int p = mv->pagina_do_quadro[q];
+        if (p == -1 || !mv->tabela[p].suja)
+            continue;
+        mv_gravar_quadro(mv, q, p);
+        mv->tabela[p].suja = 0;
+    }
+}
+
+// Destrói o vetor; páginas sujas ainda nos quadros são descartadas (veja mv_sincronizar)
+void mv_destruir(MemoriaVirtual *mv)
+{
+    if (!mv)
+        return;
+    estat_paginacao(mv->faltas, mv->despejos, mv->escritas_volta);
+    free(mv->tabela);
+    free(mv->pagina_do_quadro);
+    free(mv);
+}
+
+// Como mv_carregar pode falhar, mv_ler devolve 0 e mv_escrever descarta o valor com o vetor marcado com erro
+int32_t mv_ler(MemoriaVirtual *mv, long i)
+{
+    int32_t *quadro = mv_carregar(mv, i / mv->elementos_por_pagina);
+    return quadro ? quadro[i % mv->elementos_por_pagina] : 0;
+}
+
+void mv_escrever(MemoriaVirtual *mv, long i, int32_t valor)
+{
+    long p = i / mv->elementos_por_pagina;
+    int32_t *quadro = mv_carregar(mv, p);
+    if (!quadro)
+        return;
+    quadro[i % mv->elementos_por_pagina] = valor;
+    mv->tabela[p].suja = 1;
+}
+
+/* Fixa na memória as páginas de [inicio, inicio + n): enquanto fixadas, não são
+   despejadas e mv_ler/mv_escrever nelas não geram faltas. Se a faixa estiver dentro
+   de uma única página, devolve o endereço do elemento 'inicio' no quadro (a faixa
+   inteira é contígua); caso contrário devolve NULL mesmo tendo fixado tudo.
+   'sujar' marca as páginas como modificadas. */
+int32_t *mv_fixar(MemoriaVirtual *mv, long inicio, long n, int sujar)
+{
+    long primeira = inicio / mv->elementos_por_pagina;
+    long ultima = (inicio + n - 1) / mv->elementos_por_pagina;
+    if (ultima - primeira + 1 > mv->num_quadros)
+    {
+        mostrar("Faixa maior que a memória física da paginação.\n");
+        return NULL;
+    }
+
+    int32_t *quadro = NULL;
+    for (long p = primeira; p <= ultima; p++)
+    {
+        int32_t *q = mv_carregar(mv, p);
+        mv->tabela[p].fixacoes++;
+        if (sujar)
+            mv->tabela[p].suja = 1;
+        if (p == primeira)
+            quadro = q;
+    }
+    return (primeira == ultima && quadro) ? quadro + inicio % mv->elementos_por_pagina : NULL;
+}
+
+void mv_soltar(MemoriaVirtual *mv, long inicio, long n)
+{
+    long primeira = inicio / mv->elementos_por_pagina;
+    long ultima = (inicio + n - 1) / mv->elementos_por_pagina;
+    for (long p = primeira; p <= ultima; p++)
+        if (mv->tabela[p].fixacoes > 0)
+            mv->tabela[p].fixacoes--;
+}
+
+// 1 se alguma leitura, gravação ou falta de página deu errado desde mv_criar
+int mv_falhou(MemoriaVirtual *mv)
+{
+    return mv->erro;
+}
+
+long mv_elementos_por_pagina(MemoriaVirtual *mv)
+{
+    return mv->elementos_por_pagina;
+}
+
+void mv_exibir_contadores(MemoriaVirtual *mv)
+{
+    mostrar("Paginação: páginas de %d KB, %d quadros, %ld acessos, %ld faltas (%.2f%%), "
+           "%ld despejos, %ld gravações de volta\n",
+           mv->tam_pagina / 1024, mv->num_quadros, mv->acessos, mv->faltas,
+           mv->acessos ? 100.0 * mv->faltas / mv->acessos : 0.0, mv->despejos, mv->escritas_volta);
+}
\ No newline at end of file
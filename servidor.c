@@ -0,0 +1,588 @@
+#define _GNU_SOURCE // Deve vir antes de qualquer include
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdarg.h>
+#include <stdint.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <pthread.h>
+#include <signal.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+
+/* Modo servidor: um processo fica com o disco virtual e atende comandos de vários
+   clientes locais por um socket Unix. Cada conexão manda linhas de comando (os
+   mesmos verbos do modo em lote); a thread principal espera com poll as conexões
+   ociosas e passa cada uma que tem dados para a fila de um grupo de trabalhadores.
+   O trabalhador executa as linhas completas, uma de cada vez, e devolve a conexão
+   para o poll; assim os comandos de um cliente seguem em ordem, e os de clientes
+   diferentes rodam ao mesmo tempo.
+   A resposta de cada linha é um cabeçalho "<status> <bytes>\n" (status 0 = ok)
+   seguido de 'bytes' bytes: a saída do comando e a linha JSON do resultado.
+
+   Concorrência: configuração, formatar e desfragmentar pegam a trava do sistema
+   exclusiva (esperam os outros comandos terminarem); o resto a pega compartilhada e
+   trava o(s) arquivo(s) que usa, exclusivo para mudar e compartilhado para só ler
+   (ler, buscar e as consultas). As travas de arquivo são TRAVAS_ARQUIVOS rwlocks
+   escolhidas pelo hash do nome: dois arquivos podem cair na mesma, o que só tira
+   paralelismo. O resto do estado compartilhado fica com trava_metadados
+   (disco_virtual.c), a reserva de memória e o cache de blocos, que têm travas
+   próprias. */
+#define MAX_LINHA 1024
+#define MAX_PALAVRAS 16
+#define MAX_CONEXOES 256
+#define TRAVAS_ARQUIVOS 64
+#define TRABALHADORES_PADRAO 4
+#define REPETIR_EXCLUSIVO (-2) // Devolvido por criar quando o diretório precisa crescer
+
+// Declarações externas dos comandos (implementados em main.c e disco_virtual.c)
+extern void sistema_arquivos();
+extern int executar_comando(int n, char **p);
+extern int separar_palavras(char *texto, char **palavras);
+extern void escrever_texto_json(FILE *f, const char *s);
+extern void sincronizar_metadados();
+extern uint32_t hash_nome(const char *nome);
+
+// Declaração externa dos contadores de desempenho (implementados em estatisticas.c)
+extern void estat_iniciar_operacao(const char *nome);
+extern void estat_terminar_operacao();
+extern void estat_bytes_operacao(long *lidos, long *escritos);
+
+/* ---------- Saída dos comandos ---------- */
+
+// Para onde vai a saída do comando que esta thread executa (NULL: stdout)
+__thread FILE *saida_comando = NULL;
+
+FILE *saida_atual()
+{
+    return saida_comando ? saida_comando : stdout;
+}
+
+// printf dos comandos: no servidor, a saída vai para o cliente que pediu
+void mostrar(const char *formato, ...)
+{
+    va_list args;
+    va_start(args, formato);
+    vfprintf(saida_atual(), formato, args);
+    va_end(args);
+}
+
+/* ---------- Travas ---------- */
+
+pthread_rwlock_t trava_sistema = PTHREAD_RWLOCK_INITIALIZER;
+pthread_rwlock_t travas_arquivos[TRAVAS_ARQUIVOS];
+__thread int trava_compartilhada = 0; // 1 enquanto esta thread executa com a trava do sistema compartilhada
+
+// Verdadeiro se o comando corrente tem o sistema só para ele (sempre, fora do servidor)
+int comando_exclusivo()
+{
+    return !trava_compartilhada;
+}
+
+// Comandos que mudam o estado global ou mexem em todos os arquivos
+int comando_global(const char *verbo)
+{
+    const char *verbos[] = {"formatar", "desfragmentar", "algoritmo", "threads", "pagina", "politica",
+                            "semente", "distribuicao", "direto", "memoria", "compressao", "cache"};
+    for (int i = 0; i < (int)(sizeof(verbos) / sizeof(verbos[0])); i++)
+        if (strcmp(verbo, verbos[i]) == 0)
+            return 1;
+    return 0;
+}
+
+// Comandos que só leem o arquivo: várias execuções no mesmo arquivo rodam juntas
+int comando_de_leitura(const char *verbo)
+{
+    const char *verbos[] = {"ler", "buscar", "maiores", "menores", "quantis", "estimar", "histograma"};
+    for (int i = 0; i < (int)(sizeof(verbos) / sizeof(verbos[0])); i++)
+        if (strcmp(verbo, verbos[i]) == 0)
+            return 1;
+    return 0;
+}
+
+// Operações de conjunto: a primeira palavra depois do verbo é o destino; as outras, entradas
+int comando_de_conjunto(const char *verbo)
+{
+    const char *verbos[] = {"intercalar", "uniao", "intersecao", "diferenca"};
+    for (int i = 0; i < (int)(sizeof(verbos) / sizeof(verbos[0])); i++)
+        if (strcmp(verbo, verbos[i]) == 0)
+            return 1;
+    return 0;
+}
+
+// Comandos em que todas as palavras depois do verbo são nomes de arquivos
+int comando_de_varios_arquivos(const char *verbo)
+{
+    return strcmp(verbo, "concatenar") == 0 || comando_de_conjunto(verbo);
+}
+
+pthread_rwlock_t *trava_arquivo(const char *nome)
+{
+    return &travas_arquivos[hash_nome(nome) % TRAVAS_ARQUIVOS];
+}
+
+/* Travas de arquivo do comando, sem repetir e em ordem de endereço (para dois
+   comandos nunca esperarem um pelo outro); 'escrita[i]' diz se a i-ésima é exclusiva.
+   As operações de conjunto só leem as entradas: fica exclusivo só o destino (e uma
+   entrada que caia na mesma trava dele). Devolve quantas. */
+int travas_do_comando(int n, char **p, pthread_rwlock_t **travas, int *escrita)
+{
+    if (n < 2 || strcmp(p[0], "estatisticas") == 0 || comando_global(p[0]))
+        return 0;
+    int nomes = comando_de_varios_arquivos(p[0]) ? n - 1 : 1, num_travas = 0;
+    for (int i = 1; i <= nomes; i++)
+    {
+        pthread_rwlock_t *t = trava_arquivo(p[i]);
+        int exclusiva = !comando_de_leitura(p[0]) && (i == 1 || !comando_de_conjunto(p[0]));
+        int j = num_travas;
+        while (j > 0 && travas[j - 1] > t)
+            j--;
+        if (j > 0 && travas[j - 1] == t)
+        {
+            escrita[j - 1] |= exclusiva;
+            continue;
+        }
+        memmove(&travas[j + 1], &travas[j], (num_travas - j) * sizeof(travas[0]));
+        memmove(&escrita[j + 1], &escrita[j], (num_travas - j) * sizeof(escrita[0]));
+        travas[j] = t;
+        escrita[j] = exclusiva;
+        num_travas++;
+    }
+    return num_travas;
+}
+
+// Executa o comando com as travas que ele precisa
+int executar_travado(int n, char **p)
+{
+    pthread_rwlock_t *travas[MAX_PALAVRAS];
+    int escrita[MAX_PALAVRAS];
+    int num_travas = travas_do_comando(n, p, travas, escrita);
+    int exclusivo = comando_global(p[0]);
+    while (1)
+    {
+        if (exclusivo)
+            pthread_rwlock_wrlock(&trava_sistema);
+        else
+            pthread_rwlock_rdlock(&trava_sistema);
+        trava_compartilhada = !exclusivo;
+        for (int i = 0; i < num_travas; i++)
+        {
+            if (escrita[i])
+                pthread_rwlock_wrlock(travas[i]);
+            else
+                pthread_rwlock_rdlock(travas[i]);
+        }
+
+        int status = executar_comando(n, p);
+
+        for (int i = num_travas - 1; i >= 0; i--)
+            pthread_rwlock_unlock(travas[i]);
+        trava_compartilhada = 0;
+        pthread_rwlock_unlock(&trava_sistema);
+        if (status != REPETIR_EXCLUSIVO || exclusivo)
+            return status;
+        exclusivo = 1; // Ex.: criar precisa aumentar o diretório, que outros comandos estão usando
+    }
+}
+
+/* ---------- Conexões e trabalhadores ---------- */
+
+typedef struct
+{
+    int fd;
+    size_t usados;
+    char buf[MAX_LINHA];
+} Conexao;
+
+Conexao *fila_conexoes[MAX_CONEXOES]; // Conexões com dados, esperando um trabalhador
+int fila_inicio = 0, fila_tamanho = 0;
+int servidor_parando = 0;
+pthread_mutex_t fila_mutex = PTHREAD_MUTEX_INITIALIZER;
+pthread_cond_t fila_cond = PTHREAD_COND_INITIALIZER;
+int pipe_devolucao[2]; // Trabalhadores devolvem as conexões ao poll por aqui
+volatile sig_atomic_t sinal_recebido = 0;
+
+void tratar_sinal(int sinal)
+{
+    sinal_recebido = sinal;
+}
+
+// Escreve tudo (send com MSG_NOSIGNAL: um cliente que fechou não derruba o servidor)
+int enviar_tudo(int fd, const char *buf, size_t n)
+{
+    while (n > 0)
+    {
+        ssize_t r = send(fd, buf, n, MSG_NOSIGNAL);
+        if (r < 0 && errno == EINTR)
+            continue;
+        if (r <= 0)
+            return -1;
+        buf += r;
+        n -= r;
+    }
+    return 0;
+}
+
+// Executa uma linha do cliente e manda a resposta; -1 se o cliente não pode mais recebê-la
+int atender_linha(int fd, char *linha)
+{
+    char copia[MAX_LINHA];
+    char *palavras[MAX_PALAVRAS];
+    char *texto;
+    size_t tamanho;
+
+    linha[strcspn(linha, "#\r\n")] = '\0';
+    linha += strspn(linha, " \t");
+    snprintf(copia, sizeof(copia), "%s", linha);
+    int n = separar_palavras(copia, palavras);
+
+    FILE *saida = open_memstream(&texto, &tamanho);
+    if (!saida)
+        return -1;
+    int status = 0;
+    if (n > 0)
+    {
+        if (strcmp(palavras[0], "estatisticas") != 0)
+            estat_iniciar_operacao(linha);
+        saida_comando = saida;
+        struct timespec inicio, fim;
+        long lidos, escritos; // Contados só nesta thread: as outras conexões não entram
+        clock_gettime(CLOCK_MONOTONIC, &inicio);
+        status = executar_travado(n, palavras);
+        clock_gettime(CLOCK_MONOTONIC, &fim);
+        estat_bytes_operacao(&lidos, &escritos);
+        estat_terminar_operacao();
+        saida_comando = NULL;
+
+        fprintf(saida, "{\"comando\":");
+        escrever_texto_json(saida, linha);
+        fprintf(saida, ",\"status\":\"%s\",\"ms\":%.3f,\"bytes_lidos\":%ld,\"bytes_escritos\":%ld}\n",
+                status == 0 ? "ok" : "erro",
+                (fim.tv_sec - inicio.tv_sec) * 1000.0 + (fim.tv_nsec - inicio.tv_nsec) / 1e6, lidos, escritos);
+    }
+    fclose(saida);
+
+    char cabecalho[64];
+    int r = snprintf(cabecalho, sizeof(cabecalho), "%d %zu\n", status != 0, tamanho);
+    r = enviar_tudo(fd, cabecalho, r) == 0 && enviar_tudo(fd, texto, tamanho) == 0 ? 0 : -1;
+    free(texto);
+    return r;
+}
+
+// Lê o que chegou na conexão e executa as linhas completas; -1 se ela deve ser fechada
+int atender_conexao(Conexao *c)
+{
+    ssize_t lidos = read(c->fd, c->buf + c->usados, sizeof(c->buf) - 1 - c->usados);
+    if (lidos < 0 && errno == EINTR)
+        return 0;
+    if (lidos <= 0)
+        return -1;
+    c->usados += lidos;
+
+    char *inicio = c->buf, *fim;
+    while ((fim = memchr(inicio, '\n', c->buf + c->usados - inicio)))
+    {
+        *fim = '\0';
+        if (atender_linha(c->fd, inicio) == -1)
+            return -1;
+        inicio = fim + 1;
+    }
+    c->usados -= inicio - c->buf;
+    memmove(c->buf, inicio, c->usados);
+    if (c->usados == sizeof(c->buf) - 1)
+    {
+        fprintf(stderr, "Linha de comando longa demais; conexão fechada.\n");
+        return -1;
+    }
+    return 0;
+}
+
+void *trabalhador_servidor(void *arg)
+{
+    (void)arg;
+    while (1)
+    {
+        pthread_mutex_lock(&fila_mutex);
+        while (fila_tamanho == 0 && !servidor_parando)
+            pthread_cond_wait(&fila_cond, &fila_mutex);
+        if (fila_tamanho == 0)
+        {
+            pthread_mutex_unlock(&fila_mutex);
+            return NULL;
+        }
+        Conexao *c = fila_conexoes[fila_inicio];
+        fila_inicio = (fila_inicio + 1) % MAX_CONEXOES;
+        fila_tamanho--;
+        pthread_mutex_unlock(&fila_mutex);
+
+        if (atender_conexao(c) == -1)
+        {
+            close(c->fd);
+            free(c);
+            c = NULL; // Avisa a thread principal que a vaga ficou livre
+        }
+        if (write(pipe_devolucao[1], &c, sizeof(c)) != sizeof(c))
+            perror("Erro ao devolver a conexão");
+    }
+}
+
+// Socket Unix escutando em 'caminho' (um socket velho no mesmo caminho é removido)
+int abrir_socket_servidor(const char *caminho)
+{
+    struct sockaddr_un endereco = {.sun_family = AF_UNIX};
+    if (strlen(caminho) >= sizeof(endereco.sun_path))
+    {
+        fprintf(stderr, "Caminho do socket longo demais: %s\n", caminho);
+        return -1;
+    }
+    strcpy(endereco.sun_path, caminho);
+    int fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (fd < 0)
+    {
+        perror("Erro ao criar o socket");
+        return -1;
+    }
+    unlink(caminho);
+    if (bind(fd, (struct sockaddr *)&endereco, sizeof(endereco)) == -1 || listen(fd, 64) == -1)
+    {
+        perror("Erro ao escutar no socket");
+        close(fd);
+        return -1;
+    }
+    return fd;
+}
+
+/* Uso: mini_sistema -s <socket> [trabalhadores]. Roda até SIGINT ou SIGTERM; na
+   saída, espera os comandos em andamento e grava os metadados. */
+int modo_servidor(const char *caminho, int trabalhadores)
+{
+    if (trabalhadores <= 0)
+        trabalhadores = TRABALHADORES_PADRAO;
+    for (int i = 0; i < TRAVAS_ARQUIVOS; i++)
+        pthread_rwlock_init(&travas_arquivos[i], NULL);
+
+    sistema_arquivos();
+    int escuta = abrir_socket_servidor(caminho);
+    if (escuta < 0 || pipe2(pipe_devolucao, O_CLOEXEC) == -1)
+        return EXIT_FAILURE;
+
+    // Os sinais só chegam à thread principal, e só dentro do ppoll (sem corrida com o teste)
+    sigset_t bloqueados, livres;
+    sigemptyset(&bloqueados);
+    sigaddset(&bloqueados, SIGINT);
+    sigaddset(&bloqueados, SIGTERM);
+    pthread_sigmask(SIG_BLOCK, &bloqueados, &livres);
+    struct sigaction acao = {.sa_handler = tratar_sinal};
+    sigaction(SIGINT, &acao, NULL);
+    sigaction(SIGTERM, &acao, NULL);
+
+    pthread_t threads[trabalhadores];
+    int criadas = 0;
+    while (criadas < trabalhadores && pthread_create(&threads[criadas], NULL, trabalhador_servidor, NULL) == 0)
+        criadas++;
+    if (criadas == 0)
+    {
+        perror("Erro ao criar os trabalhadores");
+        return EXIT_FAILURE;
+    }
+    printf("Servidor escutando em %s com %d trabalhador(es).\n", caminho, criadas);
+    fflush(stdout);
+
+    // Entradas 0 e 1: socket de escuta e pipe de devolução; depois, as conexões ociosas
+    struct pollfd fds[MAX_CONEXOES + 2];
+    Conexao *ociosas[MAX_CONEXOES];
+    int num_ociosas = 0, abertas = 0;
+    while (!sinal_recebido)
+    {
+        fds[0] = (struct pollfd){escuta, abertas < MAX_CONEXOES ? POLLIN : 0, 0};
+        fds[1] = (struct pollfd){pipe_devolucao[0], POLLIN, 0};
+        for (int i = 0; i < num_ociosas; i++)
+            fds[i + 2] = (struct pollfd){ociosas[i]->fd, POLLIN, 0};
+        if (ppoll(fds, num_ociosas + 2, NULL, &livres) < 0)
+        {
+            if (errno == EINTR)
+                continue;
+            perror("Erro no poll");
+            break;
+        }
+
+        // Conexões com dados vão para a fila (as devolvidas entram no próximo poll)
+        int restantes = 0;
+        pthread_mutex_lock(&fila_mutex);
+        for (int i = 0; i < num_ociosas; i++)
+        {
+            if (fds[i + 2].revents)
+            {
+                fila_conexoes[(fila_inicio + fila_tamanho) % MAX_CONEXOES] = ociosas[i];
+                fila_tamanho++;
+                pthread_cond_signal(&fila_cond);
+            }
+            else
+                ociosas[restantes++] = ociosas[i];
+        }
+        pthread_mutex_unlock(&fila_mutex);
+        num_ociosas = restantes;
+
+        if (fds[1].revents & POLLIN)
+        {
+            Conexao *devolvidas[64];
+            ssize_t r = read(pipe_devolucao[0], devolvidas, sizeof(devolvidas));
+            for (int i = 0; i < r / (ssize_t)sizeof(Conexao *); i++)
+            {
+                if (devolvidas[i])
+                    ociosas[num_ociosas++] = devolvidas[i];
+                else
+                    abertas--;
+            }
+        }
+        if (fds[0].revents & POLLIN)
+        {
+            int fd = accept4(escuta, NULL, NULL, SOCK_CLOEXEC);
+            Conexao *c = fd >= 0 ? malloc(sizeof(Conexao)) : NULL;
+            if (c)
+            {
+                c->fd = fd;
+                c->usados = 0;
+                ociosas[num_ociosas++] = c;
+                abertas++;
+            }
+            else if (fd >= 0)
+                close(fd);
+        }
+    }
+
+    // Termina os comandos em andamento (e os que já estavam na fila)
+    printf("Encerrando o servidor...\n");
+    pthread_mutex_lock(&fila_mutex);
+    servidor_parando = 1;
+    pthread_cond_broadcast(&fila_cond);
+    pthread_mutex_unlock(&fila_mutex);
+    for (int i = 0; i < criadas; i++)
+        pthread_join(threads[i], NULL);
+    close(pipe_devolucao[1]);
+    Conexao *c;
+    while (read(pipe_devolucao[0], &c, sizeof(c)) == sizeof(c))
+        if (c)
+            ociosas[num_ociosas++] = c;
+    for (int i = 0; i < num_ociosas; i++)
+    {
+        close(ociosas[i]->fd);
+        free(ociosas[i]);
+    }
+    close(pipe_devolucao[0]);
+    close(escuta);
+    unlink(caminho);
+    sincronizar_metadados();
+    return EXIT_SUCCESS;
+}
+
+/* ---------- Cliente ---------- */
+
+// Lê exatamente 'n' bytes; -1 se a conexão fechou antes
+int receber_tudo(int fd, char *buf, size_t n)
+{
+    while (n > 0)
+    {
+        ssize_t r = read(fd, buf, n);
+        if (r < 0 && errno == EINTR)
+            continue;
+        if (r <= 0)
+            return -1;
+        buf += r;
+        n -= r;
+    }
+    return 0;
+}
+
+// Manda uma linha ao servidor e copia a resposta para stdout; 0 ok, 1 falhou, -1 conexão perdida
+int pedir_comando(int fd, const char *linha)
+{
+    char pedido[MAX_LINHA + 1];
+    int n = snprintf(pedido, sizeof(pedido), "%.*s\n", (int)strcspn(linha, "\r\n"), linha);
+    if (n >= (int)sizeof(pedido) || enviar_tudo(fd, pedido, n) == -1)
+        return -1;
+
+    char cabecalho[64];
+    size_t usados = 0;
+    while (usados < sizeof(cabecalho) - 1 && (usados == 0 || cabecalho[usados - 1] != '\n'))
+        if (receber_tudo(fd, &cabecalho[usados++], 1) == -1)
+            return -1;
+    cabecalho[usados] = '\0';
+    int falhou;
+    size_t tamanho;
+    if (sscanf(cabecalho, "%d %zu", &falhou, &tamanho) != 2)
+        return -1;
+
+    char *texto = malloc(tamanho + 1);
+    if (!texto || receber_tudo(fd, texto, tamanho) == -1)
+    {
+        free(texto);
+        return -1;
+    }
+    fwrite(texto, 1, tamanho, stdout);
+    fflush(stdout);
+    free(texto);
+    return falhou;
+}
+
+// Manda as linhas do script (ou da entrada padrão, se "-"); devolve as falhas ou -1
+int pedir_script(int fd, const char *caminho)
+{
+    FILE *f = strcmp(caminho, "-") == 0 ? stdin : fopen(caminho, "r");
+    if (!f)
+    {
+        perror("Erro ao abrir script");
+        return 1;
+    }
+    int falhas = 0;
+    char linha[MAX_LINHA];
+    while (fgets(linha, sizeof(linha), f))
+    {
+        if (linha[strspn(linha, " \t")] == '#' || linha[strspn(linha, " \t\r\n")] == '\0')
+            continue;
+        int r = pedir_comando(fd, linha);
+        if (r == -1)
+        {
+            falhas = -1;
+            break;
+        }
+        falhas += r;
+    }
+    if (f != stdin)
+        fclose(f);
+    return falhas;
+}
+
+// Uso: mini_sistema -c <socket> [-f script | -] ["comando" ...]
+int modo_cliente(const char *caminho, int argc, char **argv)
+{
+    struct sockaddr_un endereco = {.sun_family = AF_UNIX};
+    snprintf(endereco.sun_path, sizeof(endereco.sun_path), "%s", caminho);
+    int fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (fd < 0 || connect(fd, (struct sockaddr *)&endereco, sizeof(endereco)) == -1)
+    {
+        perror("Erro ao conectar ao servidor");
+        return EXIT_FAILURE;
+    }
+
+    int falhas = 0;
+    for (int i = 1; i < argc && falhas >= 0; i++)
+    {
+        int r;
+        if (strcmp(argv[i], "-") == 0)
+            r = pedir_script(fd, "-");
+        else if (strcmp(argv[i], "-f") == 0 && i + 1 < argc)
+            r = pedir_script(fd, argv[++i]);
+        else
+            r = pedir_comando(fd, argv[i]);
+        falhas = r == -1 ? -1 : falhas + r;
+    }
+    close(fd);
+    if (falhas < 0)
+        fprintf(stderr, "Conexão com o servidor perdida.\n");
+    return falhas ? EXIT_FAILURE : EXIT_SUCCESS;
+}
\ No newline at end of file